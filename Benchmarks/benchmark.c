@@ -0,0 +1,490 @@
+/**
+ * @file benchmark.c
+ * @brief Per-module benchmark suite of the drivers, built on the profiler.
+ *
+ * Times the hot functions of every module and the interrupt entry latency, then
+ * writes the profiler CSV report:
+ *  - on the target (make benchmark-avr, flash or run the ELF under simavr) the
+ *    report goes out of the UART at BENCHMARK_BAUD_RATE and the numbers are real
+ *    CPU cycles,
+ *  - on the host model (make benchmark) it is printed on stdout and the columns
+ *    are model ticks, not cycles: HOST_CYCLES_PER_ACCESS per register access plus
+ *    the peripheral and delay waits, the code between two accesses is free (see
+ *    host_model.h). FRAME_crc16 and FORMAT_print touch no register and read 0,
+ *    GPIO_writePin and GPIO_writePinFast both are one access. The host figures
+ *    compare two versions of a driver's register traffic, only the target ones
+ *    are cycles.
+ *
+ * Entry latency of INT0 is measured from the instruction that raises PD2 (INT0
+ * triggers on an output pin too, the data sheet "software interrupt") to the
+ * first line of the EXTI callback, so it includes the vector, the ISR prologue
+ * and the EXTI dispatch. The worst-case latency of any interrupt adds the longest
+ * critical section (the *Atomic entries) and the longest ISR body, see profiler.h.
+ *
+ * The Timer0 overflow latency is measured the same way, from TIMER0_start with
+ * TCNT0 = 0xFF to the timer_0 overflow callback.
+ *
+ * sprintf %u is the libc baseline of the FORMAT_print %u cycles. For the flash
+ * side compare the text column with and without the sprintf entry, which is
+ * what pulls vfprintf into the image.
+ *
+ * SPI_transfer is timed on a BENCHMARK_BLOCK_SIZE block at fosc/2 and its
+ * throughput is printed in bytes/s after the report.
+ *
+ * The TWI and external EEPROM entries need a 24C16 at 0x50 on the bus (a
+ * HOST_TwiSlave memory on the host), an entry whose transfer fails is not counted
+ * and reports 0 calls. LCD_displayCharacter drives the 4-bit LCD pins, its
+ * 7 x delay_ms(1) fit one Timer1 period up to 9 MHz only, so it is left out above.
+ * KEYPAD_getKey returns only on a key press: the host model holds COL0 low, on the
+ * target the entry is timed only while the key of ROW0 x COL0 is held.
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#include "../profiler.h"
+#include "../format.h"
+#include "../MCAL/gpio/gpio.h"
+#include "../MCAL/gpio/gpio_fast.h"
+#include "../MCAL/exti/exti.h"
+#include "../MCAL/Communication/UART/uart.h"
+#include "../MCAL/Communication/SPI/spi.h"
+#include "../MCAL/Communication/I2C/twi.h"
+#include "../MCAL/Timers/timer_0/timer_0.h"
+#include "../HAL/Frame_Transport/frame.h"
+#include "../HAL/Debounce/debounce.h"
+#include "../HAL/External_EEPROM/external_eeprom.h"
+#include "../HAL/Character_LCD/lcd.h"
+#include "../HAL/keypad/keypad.h"
+#include "../MCAL/Atmega32_Registers.h"
+#include "../delay.h"
+
+/* sprintf, the libc baseline of FORMAT_print */
+#include <stdio.h>
+
+#if defined (HOST_BUILD)
+#include "../MCAL/Host_Model/host_model.h"
+#endif
+
+/* Report output on the target */
+#define BENCHMARK_BAUD_RATE 9600
+
+/* Measurements per entry, min / max / average are kept */
+#define BENCHMARK_RUNS 16
+
+/* Length of the buffers used by the block functions */
+#define BENCHMARK_BLOCK_SIZE 32
+
+/* 7-bit address of the 24C16 used by the TWI and EEPROM entries */
+#define BENCHMARK_EEPROM_ADDRESS 0x50
+
+/* LCD_displayCharacter waits 7 x delay_ms(1), one Timer1 period holds 65535 cycles */
+#define BENCHMARK_LCD_FITS (((F_CPU / 1000UL) * 7UL) <= 64000UL)
+
+typedef enum {
+	BENCH_GPIO_WRITE_PIN,
+	BENCH_GPIO_READ_PIN,
+	BENCH_GPIO_WRITE_PIN_FAST,
+	BENCH_GPIO_SET_PIN_ATOMIC,
+	BENCH_GPIO_MODIFY_PORT_ATOMIC,
+	BENCH_UART_SEND_BYTE,
+	BENCH_SPI_TRANSFER,
+	BENCH_FRAME_CRC16,
+	BENCH_FORMAT_PRINT,
+	BENCH_SPRINTF,
+	BENCH_DEBOUNCE_TICK,
+	BENCH_INT0_LATENCY,
+	BENCH_TWI_WRITE_REGS,
+	BENCH_TWI_READ_REGS,
+	BENCH_EEPROM_WRITE_BYTE,
+	BENCH_EEPROM_READ_BLOCK,
+	BENCH_LCD_DISPLAY_CHARACTER,
+	BENCH_KEYPAD_GET_KEY,
+	BENCH_TIMER0_GET_TICKS,
+	BENCH_TIMER0_LATENCY,
+	BENCH_DELAY_US_10,
+	BENCH_DELAY_US_100,
+	BENCH_COUNT
+} BENCHMARK_Id;
+
+static PROFILER_Entry entries[BENCH_COUNT] = {
+	PROFILER_ENTRY("GPIO_writePin"),
+	PROFILER_ENTRY("GPIO_readPin"),
+	PROFILER_ENTRY("GPIO_writePinFast"),
+	PROFILER_ENTRY("GPIO_setPinAtomic"),
+	PROFILER_ENTRY("GPIO_modifyPortAtomic"),
+	PROFILER_ENTRY("UART_sendByte"),
+	PROFILER_ENTRY("SPI_transfer 32B"),
+	PROFILER_ENTRY("FRAME_crc16 32B"),
+	PROFILER_ENTRY("FORMAT_print %u"),
+	PROFILER_ENTRY("sprintf %u"),
+	PROFILER_ENTRY("DEBOUNCE_tick"),
+	PROFILER_ENTRY("INT0 entry latency"),
+	PROFILER_ENTRY("TWI_writeRegs 4B"),
+	PROFILER_ENTRY("TWI_readRegs 4B"),
+	PROFILER_ENTRY("EEPROM_writeByte"),
+	PROFILER_ENTRY("EEPROM_readBlock 32B"),
+	PROFILER_ENTRY("LCD_displayCharacter"),
+	PROFILER_ENTRY("KEYPAD_getKey"),
+	PROFILER_ENTRY("TIMER0_getTicks"),
+	PROFILER_ENTRY("TIMER0 OVF latency"),
+	PROFILER_ENTRY("delay_us 10"),
+	PROFILER_ENTRY("delay_us 100"),
+};
+
+static uint8 block[BENCHMARK_BLOCK_SIZE];
+
+static volatile uint16 int0_start;
+static volatile boolean int0_done;
+
+static void BENCHMARK_int0Callback(void) {
+	PROFILER_stop(&entries[BENCH_INT0_LATENCY], int0_start);
+	int0_done = TRUE;
+}
+
+static volatile uint16 timer0_start;
+static volatile boolean timer0_done;
+
+static void BENCHMARK_timer0Callback(void) {
+	PROFILER_stop(&entries[BENCH_TIMER0_LATENCY], timer0_start);
+	timer0_done = TRUE;
+}
+
+#if defined (HOST_BUILD)
+/* 24C16 block 0 on the simulated bus: the first written byte is the address */
+static uint8 eeprom_memory[256];
+static uint8 eeprom_pointer;
+static boolean eeprom_pointer_next;
+
+static boolean BENCHMARK_eepromStart(boolean read) {
+	if (!read) {
+		eeprom_pointer_next = TRUE;
+	}
+	return TRUE;
+}
+
+static boolean BENCHMARK_eepromWrite(uint8 data) {
+	if (eeprom_pointer_next) {
+		eeprom_pointer_next = FALSE;
+		eeprom_pointer = data;
+	} else {
+		eeprom_memory[eeprom_pointer++] = data;
+	}
+	return TRUE;
+}
+
+static uint8 BENCHMARK_eepromRead(void) {
+	return eeprom_memory[eeprom_pointer++];
+}
+
+static const HOST_TwiSlave eeprom_device = { BENCHMARK_EEPROM_ADDRESS,
+		BENCHMARK_eepromStart, BENCHMARK_eepromWrite, BENCHMARK_eepromRead, NULL_PTR };
+#endif
+
+static void BENCHMARK_discard(uint8 character) {
+	(void) character;
+}
+
+static void BENCHMARK_sink(const uint8 *line) {
+#if defined (HOST_BUILD)
+	fputs((const char*) line, stdout);
+#else
+	UART_sendString(line);
+#endif
+}
+
+static void BENCHMARK_putCharacter(uint8 character) {
+#if defined (HOST_BUILD)
+	putchar(character);
+#else
+	UART_sendByte(character);
+#endif
+}
+
+/*
+ * Bytes per second of length bytes moved in cycles. Multiply before dividing
+ * (64-bit, length * F_CPU passes 32 bits above 268 bytes at 16 MHz) so the
+ * result is exact to the byte/s.
+ */
+static uint32 BENCHMARK_throughput(uint16 length, uint32 cycles) {
+	if (cycles == 0) {
+		return 0;
+	}
+	return (uint32) (((uint64) length * F_CPU) / cycles);
+}
+
+static void BENCHMARK_gpio(void) {
+	uint16 start;
+	uint8 run;
+
+	GPIO_setupPinDirection(A0, PIN_OUTPUT);
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		start = PROFILER_start();
+		GPIO_writePin(A0, run & 1);
+		PROFILER_stop(&entries[BENCH_GPIO_WRITE_PIN], start);
+
+		start = PROFILER_start();
+		(void) GPIO_readPin(A0);
+		PROFILER_stop(&entries[BENCH_GPIO_READ_PIN], start);
+
+		start = PROFILER_start();
+		GPIO_writePinFast(A0, LOGIC_HIGH);
+		PROFILER_stop(&entries[BENCH_GPIO_WRITE_PIN_FAST], start);
+
+		start = PROFILER_start();
+		GPIO_setPinAtomic(A0);
+		PROFILER_stop(&entries[BENCH_GPIO_SET_PIN_ATOMIC], start);
+
+		start = PROFILER_start();
+		GPIO_modifyPortAtomic(PORTA_ID, 0x0F, run);
+		PROFILER_stop(&entries[BENCH_GPIO_MODIFY_PORT_ATOMIC], start);
+	}
+}
+
+static void BENCHMARK_uart(void) {
+	uint16 start;
+	uint8 run;
+
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		/* Let UDR empty so only the driver path is timed, not the wire */
+		while (BIT_IS_CLEAR(UCSRA, UDRE)) {
+#if defined (HOST_BUILD)
+			HOST_advanceCycles(16);
+#endif
+		}
+		start = PROFILER_start();
+		UART_sendByte('.');
+		PROFILER_stop(&entries[BENCH_UART_SEND_BYTE], start);
+	}
+	UART_sendByte('\n');
+}
+
+static void BENCHMARK_spi(void) {
+	const SPI_Config config = { SPI_FCPU_2, SPI_MODE_0, SPI_MSB };
+	uint16 start;
+	uint8 run;
+
+	SPI_initMaster(&config);
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		/* In place, the received bytes replace the sent ones */
+		start = PROFILER_start();
+		SPI_transfer(block, block, BENCHMARK_BLOCK_SIZE);
+		PROFILER_stop(&entries[BENCH_SPI_TRANSFER], start);
+	}
+}
+
+static void BENCHMARK_hal(void) {
+	char text[8];
+	uint16 start;
+	uint8 run;
+
+	for (run = 0; run < BENCHMARK_BLOCK_SIZE; run++) {
+		block[run] = run;
+	}
+	DEBOUNCE_init();
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		start = PROFILER_start();
+		(void) FRAME_crc16(0xFFFF, block, BENCHMARK_BLOCK_SIZE);
+		PROFILER_stop(&entries[BENCH_FRAME_CRC16], start);
+
+		start = PROFILER_start();
+		(void) FORMAT_print(BENCHMARK_discard, "%u", 65535U - run);
+		PROFILER_stop(&entries[BENCH_FORMAT_PRINT], start);
+
+		/* Same number, to a buffer: the output loop is not even counted here */
+		start = PROFILER_start();
+		(void) sprintf(text, "%u", 65535U - run);
+		PROFILER_stop(&entries[BENCH_SPRINTF], start);
+
+		start = PROFILER_start();
+		DEBOUNCE_tick();
+		PROFILER_stop(&entries[BENCH_DEBOUNCE_TICK], start);
+	}
+}
+
+static void BENCHMARK_twi(void) {
+	TWI_ConfigType config = { 0x01, SCL_400kbit };
+	uint16 start;
+	uint8 run;
+
+#if defined (HOST_BUILD)
+	HOST_twiAttachSlave(&eeprom_device);
+#endif
+	TWI_init(&config);
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		start = PROFILER_start();
+		if (TWI_writeRegs(BENCHMARK_EEPROM_ADDRESS, 0x00, block, 4) == TWI_RESULT_OK) {
+			PROFILER_stop(&entries[BENCH_TWI_WRITE_REGS], start);
+		}
+		/* Let the write cycle of the EEPROM end before the next access */
+		delay_ms(5);
+
+		start = PROFILER_start();
+		if (TWI_readRegs(BENCHMARK_EEPROM_ADDRESS, 0x00, block, 4) == TWI_RESULT_OK) {
+			PROFILER_stop(&entries[BENCH_TWI_READ_REGS], start);
+		}
+
+		start = PROFILER_start();
+		if (EEPROM_writeByte(run, run) == SUCCESS) {
+			PROFILER_stop(&entries[BENCH_EEPROM_WRITE_BYTE], start);
+		}
+		delay_ms(5);
+
+		start = PROFILER_start();
+		if (EEPROM_readBlock(0, block, BENCHMARK_BLOCK_SIZE) == SUCCESS) {
+			PROFILER_stop(&entries[BENCH_EEPROM_READ_BLOCK], start);
+		}
+	}
+}
+
+static void BENCHMARK_lcd(void) {
+#if BENCHMARK_LCD_FITS
+	uint16 start;
+	uint8 run;
+
+	LCD_init();
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		start = PROFILER_start();
+		LCD_displayCharacter('0' + (run % 10));
+		PROFILER_stop(&entries[BENCH_LCD_DISPLAY_CHARACTER], start);
+	}
+#endif
+}
+
+static void BENCHMARK_keypad(void) {
+	uint16 start;
+	uint8 run;
+
+	/* MOSI and SCK of the SPI are ROW1 and ROW3 of the keypad */
+	CLEAR_BIT(SPCR, SPE);
+#if defined (HOST_BUILD)
+	HOST_setPin(COL0, LOGIC_LOW);
+#else
+	GPIO_writePin(ROW0, LOGIC_LOW);
+	GPIO_setupPinDirection(ROW0, PIN_OUTPUT);
+	if (GPIO_readPin(COL0) != LOGIC_LOW) {
+		GPIO_setupPinDirection(ROW0, PIN_INPUT);
+		return;
+	}
+#endif
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		start = PROFILER_start();
+		(void) KEYPAD_getKey();
+		PROFILER_stop(&entries[BENCH_KEYPAD_GET_KEY], start);
+	}
+	GPIO_setupPinDirection(ROW0, PIN_INPUT);
+}
+
+static void BENCHMARK_timer0(void) {
+	uint16 start;
+	uint8 run;
+
+	SetMode(TIMER0_MODE_NORMAL);
+	set_Clock(TIMER0_CLK_SYSTEM);
+	setOverFlowCallback(BENCHMARK_timer0Callback);
+	TIMER0_start();
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		start = PROFILER_start();
+		(void) TIMER0_getTicks();
+		PROFILER_stop(&entries[BENCH_TIMER0_GET_TICKS], start);
+	}
+
+	TIMER0_stop();
+	enableOverFlowInterrupt();
+	GLOBAL_INTERRUPT_ENABLE();
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		/* The overflow comes one timer clock after the start */
+		TIMER0_setStart(0xFF);
+		timer0_done = FALSE;
+		timer0_start = PROFILER_start();
+		TIMER0_start();
+		while (!timer0_done) {
+#if defined (HOST_BUILD)
+			HOST_advanceCycles(1);
+#endif
+		}
+		TIMER0_stop();
+	}
+	GLOBAL_INTERRUPT_DISABLE();
+	disableOverFlowInterrupt();
+}
+
+static void BENCHMARK_delay(void) {
+	uint16 start;
+	uint8 run;
+
+	/* Expected 10 and 100 us of F_CPU cycles plus the call */
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		start = PROFILER_start();
+		delay_us(10);
+		PROFILER_stop(&entries[BENCH_DELAY_US_10], start);
+
+		start = PROFILER_start();
+		delay_us(100);
+		PROFILER_stop(&entries[BENCH_DELAY_US_100], start);
+	}
+}
+
+static void BENCHMARK_interruptLatency(void) {
+	uint8 run;
+
+	EXTI_init(EXTI_INT0, EXTI_SENSE_RISING_EDGE);
+	EXTI_setCallback(EXTI_INT0, BENCHMARK_int0Callback);
+	/* Drive PD2 from software, the edge detector still sees it */
+	GPIO_writePin(D2, LOGIC_LOW);
+	GPIO_setupPinDirection(D2, PIN_OUTPUT);
+	EXTI_clearFlag(EXTI_INT0);
+	EXTI_enable(EXTI_INT0);
+	GLOBAL_INTERRUPT_ENABLE();
+
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		int0_done = FALSE;
+		int0_start = PROFILER_start();
+		GPIO_writePinFast(D2, LOGIC_HIGH);
+		while (!int0_done) {
+#if defined (HOST_BUILD)
+			HOST_advanceCycles(1);
+#endif
+		}
+		GPIO_writePinFast(D2, LOGIC_LOW);
+	}
+
+	GLOBAL_INTERRUPT_DISABLE();
+	EXTI_disable(EXTI_INT0);
+	GPIO_setupPinDirection(D2, PIN_INPUT);
+}
+
+int main(void) {
+#if defined (HOST_BUILD)
+	HOST_reset();
+#endif
+	UART_init(BENCHMARK_BAUD_RATE);
+
+	if (!PROFILER_init()) {
+		UART_sendString((const uint8*) "Timer1 busy, no benchmark\n");
+		return 1;
+	}
+
+	BENCHMARK_gpio();
+	BENCHMARK_uart();
+	BENCHMARK_spi();
+	BENCHMARK_hal();
+	BENCHMARK_interruptLatency();
+	BENCHMARK_twi();
+	BENCHMARK_lcd();
+	BENCHMARK_keypad();
+	BENCHMARK_timer0();
+	BENCHMARK_delay();
+
+	PROFILER_report(entries, BENCH_COUNT, BENCHMARK_sink);
+	FORMAT_print(BENCHMARK_putCharacter, "SPI_transfer,%lu bytes/s\n",
+			BENCHMARK_throughput(BENCHMARK_BLOCK_SIZE,
+					entries[BENCH_SPI_TRANSFER].min_cycles));
+	PROFILER_release();
+
+#if !defined (HOST_BUILD)
+	for (;;) {
+	}
+#endif
+	return 0;
+}
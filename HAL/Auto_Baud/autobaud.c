@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ * Module: HAL/AUTOBAUD
+ *
+ * File Name: autobaud.c
+ *
+ * Description: Source file for the UART automatic baud rate detection
+ *
+ * Author: Mohamed Sayed
+ *
+ *******************************************************************************/
+
+#include "autobaud.h"
+#include "../../MCAL/Communication/UART/uart.h"
+#include "../../MCAL/Timers/timer_1/timer_1.h"
+#include "../../MCAL/gpio/gpio.h"
+#include "../../MCAL/Atmega32_Registers.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Falling edges of the sync byte 0x55, 4 intervals of 2 bit times */
+#define AUTOBAUD_SYNC_EDGES 5
+
+/* ICP1 pin */
+#define AUTOBAUD_ICP_PIN D6
+
+/*******************************************************************************
+ *                              Private Variables                              *
+ *******************************************************************************/
+
+static volatile AUTOBAUD_Status autobaud_status = AUTOBAUD_IDLE;
+
+/* Capture state, only used by the capture ISR until the lock */
+static uint8 autobaud_edges;
+static uint16 autobaud_last_capture;
+static uint16 autobaud_first_interval;
+static volatile uint32 autobaud_total;
+
+static volatile uint16 autobaud_rejected = 0;
+
+/*******************************************************************************
+ *                              Private Functions                              *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Program the UART for the measured 8 bit times (total Timer1 ticks at F_CPU) and
+ * enable the receiver. Return FALSE if no setting is within UART_BAUD_TOLERANCE.
+ */
+static boolean AUTOBAUD_applyRate(uint32 total) {
+	UART_BaudSetting setting;
+	/* UBRR + 1 = bit / 16 = total / 128, or bit / 8 = total / 64 for U2X = 1 */
+	uint32 normal = (total + 64) >> 7;
+	uint32 fast = (total + 32) >> 6;
+	uint32 error_normal;
+	uint32 error_fast;
+	uint32 error;
+
+	error_normal = (total > (normal << 7)) ? (total - (normal << 7)) : ((normal << 7) - total);
+	error_fast = (total > (fast << 6)) ? (total - (fast << 6)) : ((fast << 6) - total);
+
+	if ((fast > 4096) || ((normal != 0) && (normal <= 4096) && (error_normal <= error_fast))) {
+		/* U2X = 0 samples each bit 16 times, it is kept unless U2X = 1 is more accurate */
+		setting.ubrr = (uint16) (normal - 1);
+		setting.double_speed = FALSE;
+		error = error_normal;
+	} else {
+		setting.ubrr = (uint16) (fast - 1);
+		setting.double_speed = TRUE;
+		error = error_fast;
+	}
+
+	/* Both errors are in ticks of the same 8 bit times, compare in 0.1 % units */
+	if ((setting.ubrr > 4095) || (error * 1000 > UART_BAUD_TOLERANCE * total)) {
+		return FALSE;
+	}
+
+	UART_setBaudSetting(&setting);
+	UART_enableReceiver(TRUE);
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Timer1 capture callback, called on every falling edge of RXD.
+ */
+static void AUTOBAUD_captureEdge(void) {
+	uint16 capture = TIMER1_get_ICU_Value();
+	uint16 interval = capture - autobaud_last_capture;
+	uint16 quarter = autobaud_first_interval >> 2;
+
+	autobaud_last_capture = capture;
+	autobaud_edges++;
+	if (autobaud_edges == 1) {
+		return;
+	}
+
+	/* Accept the intervals within first - 1/4 .. first + 1/4 */
+	if ((autobaud_edges == 2)
+			|| ((uint16) (interval - (autobaud_first_interval - quarter)) > 2 * quarter)) {
+		/* First interval, or the previous edge starts a new sync byte */
+		autobaud_first_interval = interval;
+		autobaud_total = interval;
+		autobaud_edges = 2;
+		return;
+	}
+
+	autobaud_total += interval;
+	if (autobaud_edges < AUTOBAUD_SYNC_EDGES) {
+		return;
+	}
+
+	/* Bit 8 is on the line, the receiver waits for the next start bit */
+	if (AUTOBAUD_applyRate(autobaud_total)) {
+		TIMER1_disable_ICU_Interrupt();
+		TIMER1_stop();
+		autobaud_status = AUTOBAUD_LOCKED;
+	} else {
+		if (autobaud_rejected != 0xFFFF) {
+			autobaud_rejected++;
+		}
+		autobaud_edges = 0;
+	}
+}
+
+/*******************************************************************************
+ *                              Functions Definitions                          *
+ *******************************************************************************/
+
+void AUTOBAUD_start(void) {
+	TIMER1_disable_ICU_Interrupt();
+	UART_enableReceiver(FALSE);
+	autobaud_edges = 0;
+	autobaud_status = AUTOBAUD_WAITING;
+
+	GPIO_setupPinDirection(AUTOBAUD_ICP_PIN, PIN_INPUT);
+
+	/* Free running at F_CPU, capture the falling edges through the noise canceler */
+	TIMER1_stop();
+	TIMER1_SetMode(TIMER1_MODE_NORMAL);
+	TIMER1_set_Clock(TIMER1_CLK_SYSTEM);
+	TIMER1_set_ICU_Edge(TIMER1_ICU_FALLING_EDGE);
+	TIMER1_set_ICU_NoiseCanceler(TRUE);
+	TIMER1_set_ICU_Callback(AUTOBAUD_captureEdge);
+	TIMER1_clear_ICU_Flag();
+	TIMER1_enable_ICU_Interrupt();
+	TIMER1_start();
+}
+
+void AUTOBAUD_stop(void) {
+	TIMER1_disable_ICU_Interrupt();
+	TIMER1_stop();
+	TIMER1_set_ICU_Callback(NULL_PTR);
+	if (autobaud_status == AUTOBAUD_WAITING) {
+		autobaud_status = AUTOBAUD_IDLE;
+	}
+}
+
+AUTOBAUD_Status AUTOBAUD_getStatus(void) {
+	return autobaud_status;
+}
+
+uint32 AUTOBAUD_getMeasuredBaudRate(void) {
+	/* autobaud_total is only written by the capture ISR before the lock */
+	if (autobaud_status != AUTOBAUD_LOCKED) {
+		return 0;
+	}
+	return (8UL * F_CPU + autobaud_total / 2) / autobaud_total;
+}
+
+uint16 AUTOBAUD_getRejectedCount(void) {
+	uint8 sreg = SREG;
+	uint16 count;
+
+	/* The 16-bit counter is updated by the capture ISR */
+	GLOBAL_INTERRUPT_DISABLE();
+	count = autobaud_rejected;
+	SREG = sreg;
+	return count;
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+ *
+ * Module: HAL/AUTOBAUD
+ *
+ * File Name: autobaud.h
+ *
+ * Description: Header File for the UART automatic baud rate detection
+ *
+ * Author: Mohamed Sayed
+ *
+ *******************************************************************************/
+#ifndef ATMEGA32_DRIVERS_AUTOBAUD_H_
+#define ATMEGA32_DRIVERS_AUTOBAUD_H_
+
+#include "../../std_types.h"
+
+/*******************************************************************************
+ *                                Description                                  *
+ *******************************************************************************
+ * The host sends the sync byte 0x55 ('U'). Sent LSB first it is a square wave,
+ * its falling edges are at bit 0 (start bit), 2, 4, 6 and 8:
+ *
+ *   line : idle 1 | start 0 | 1 0 1 0 1 0 1 0 | stop 1
+ *   falling edge at :   0         2   4   6   8     (bit times)
+ *
+ * Timer1 runs at F_CPU and the input capture unit timestamps the falling edges
+ * on ICP1 (PD6), so RXD (PD0) must also be wired to PD6. The 4 intervals must
+ * agree within 1/4, an interval that does not restarts the measurement from the
+ * previous edge. The bit time is the sum of the intervals / 8, then:
+ *  - UBRR and U2X are computed from it with shifts only (UBRR + 1 = bit / 16 or
+ *    bit / 8, the one with the smaller rounding error),
+ *  - the receiver is enabled again from the last falling edge (bit 8 is low, so
+ *    the next high to low transition is the start bit of the next byte).
+ * The lock is confirmed when the setting is within UART_BAUD_TOLERANCE of the
+ * measured rate, so the link is up right after the one sync character.
+ *
+ * Limits: the capture ISR has 2 bit times between two edges (about 139 cycles at
+ * 115200 baud and 8 MHz), so up to 115200 baud at 8 MHz and 230400 at 16 MHz.
+ * Two bit times must fit in 16 bits, so down to 2 * F_CPU / 65536 (245 at 8 MHz).
+ * Rates that no UBRR setting reaches within UART_BAUD_TOLERANCE at this F_CPU
+ * (57600 and 115200 at 8 MHz) are rejected and the next sync byte is awaited.
+ * A stream of identical bytes with a single falling edge (0x00, 0xF0 ...) has
+ * regular intervals too and must not be sent instead of the sync byte.
+ *
+ * Timer1 and its capture callback are used during the detection, so the profiler
+ * can not run at the same time.
+ *******************************************************************************/
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+typedef enum {
+	AUTOBAUD_IDLE, /* AUTOBAUD_start not called */
+	AUTOBAUD_WAITING, /* waiting for the sync byte */
+	AUTOBAUD_LOCKED, /* the UART runs at the detected baud rate */
+} AUTOBAUD_Status;
+
+/*******************************************************************************
+ *                                FUNCTIONS PROTOTYPE                          *
+ *******************************************************************************/
+
+/**
+ * @brief Start the detection, the UART must be initialized (UART_init or
+ * UART_initInterrupt with any baud rate). The receiver is disabled until the lock.
+ */
+void AUTOBAUD_start(void);
+
+/**
+ * @brief Stop the detection and give Timer1 back, the receiver stays disabled
+ * if it was not locked.
+ */
+void AUTOBAUD_stop(void);
+
+AUTOBAUD_Status AUTOBAUD_getStatus(void);
+
+/**
+ * @brief Return the baud rate measured from the sync byte, 0 before the lock.
+ * UART_getBaudRate returns the rate of the UBRR setting chosen for it.
+ */
+uint32 AUTOBAUD_getMeasuredBaudRate(void);
+
+/**
+ * @brief Return the number of sync bytes rejected because the setting error was
+ * above UART_BAUD_TOLERANCE (out of the UBRR range or between two settings).
+ */
+uint16 AUTOBAUD_getRejectedCount(void);
+
+#endif /* ATMEGA32_DRIVERS_AUTOBAUD_H_ */
@@ -9,7 +9,7 @@
 
 #include "lcd.h"
 #include "../../delay.h"
-#include <stdlib.h>
+#include "../../format.h"
 
 /**
  * @defgroup Parallel8BitsFullPort Parallel 8 Bits Full Port Mode
@@ -57,6 +57,17 @@ void LCD_init(void) {
 
 #if defined (PARALLEL_8_BITS_RANDOM)
 
+/**
+ * @brief Data pins of the LCD, bit i of the command is written to lcd_data_pins[i].
+ */
+static const uint8 lcd_data_pins[] = { DATA0, DATA1, DATA2, DATA3, DATA4, DATA5,
+        DATA6, DATA7 };
+
+/**
+ * @brief Pin group of the data pins, one read-modify-write per port per write.
+ */
+static GPIO_PinGroup lcd_data_group;
+
 /**
  * @brief Send a command to the LCD in parallel 8 bits random mode.
  *
@@ -67,14 +78,7 @@ static void send(uint8 command) {
     GPIO_writePin(E, LOGIC_HIGH);
     delay_ms(1);
 
-    GPIO_writePin(DATA0, GET_BIT(command, 0));
-    GPIO_writePin(DATA1, GET_BIT(command, 1));
-    GPIO_writePin(DATA2, GET_BIT(command, 2));
-    GPIO_writePin(DATA3, GET_BIT(command, 3));
-    GPIO_writePin(DATA4, GET_BIT(command, 4));
-    GPIO_writePin(DATA5, GET_BIT(command, 5));
-    GPIO_writePin(DATA6, GET_BIT(command, 6));
-    GPIO_writePin(DATA7, GET_BIT(command, 7));
+    GPIO_writePinGroup(&lcd_data_group, command);
 
     delay_ms(1);
     GPIO_writePin(E, LOGIC_LOW);
@@ -88,14 +92,8 @@ void LCD_init(void) {
     GPIO_setupPinDirection(RS, PIN_OUTPUT);
     GPIO_setupPinDirection(E, PIN_OUTPUT);
 
-    GPIO_setupPinDirection(DATA0, PIN_OUTPUT);
-    GPIO_setupPinDirection(DATA1, PIN_OUTPUT);
-    GPIO_setupPinDirection(DATA2, PIN_OUTPUT);
-    GPIO_setupPinDirection(DATA3, PIN_OUTPUT);
-    GPIO_setupPinDirection(DATA4, PIN_OUTPUT);
-    GPIO_setupPinDirection(DATA5, PIN_OUTPUT);
-    GPIO_setupPinDirection(DATA6, PIN_OUTPUT);
-    GPIO_setupPinDirection(DATA7, PIN_OUTPUT);
+    GPIO_setupPinGroup(&lcd_data_group, lcd_data_pins, sizeof(lcd_data_pins));
+    GPIO_setupPinGroupDirection(&lcd_data_group, PIN_OUTPUT);
 
     delay_ms(20);
     LCD_sendCommand(LCD_COMMAND_8BIT_2Line_F1);
@@ -113,6 +111,16 @@ void LCD_init(void) {
 
 #if defined (PARALLEL_4_BITS)
 
+/**
+ * @brief Data pins of the LCD, bit i of a nibble is written to lcd_data_pins[i].
+ */
+static const uint8 lcd_data_pins[] = { DATA4, DATA5, DATA6, DATA7 };
+
+/**
+ * @brief Pin group of the data pins, one read-modify-write per port per nibble.
+ */
+static GPIO_PinGroup lcd_data_group;
+
 /**
  * @brief Send a command to the LCD in parallel 4 bits mode.
  *
@@ -122,10 +130,7 @@ static void send(uint8 command) {
 	delay_ms(1);
 	GPIO_writePin(E, LOGIC_HIGH);
 	delay_ms(1);
-	GPIO_writePin(DATA4, GET_BIT(command, 4));
-	GPIO_writePin(DATA5, GET_BIT(command, 5));
-	GPIO_writePin(DATA6, GET_BIT(command, 6));
-	GPIO_writePin(DATA7, GET_BIT(command, 7));
+	GPIO_writePinGroup(&lcd_data_group, command >> 4);
 
 	delay_ms(1);
 	GPIO_writePin(E, LOGIC_LOW);
@@ -133,10 +138,7 @@ static void send(uint8 command) {
 	GPIO_writePin(E, LOGIC_HIGH);
 	delay_ms(1);
 
-	GPIO_writePin(DATA4, GET_BIT(command, 0));
-	GPIO_writePin(DATA5, GET_BIT(command, 1));
-	GPIO_writePin(DATA6, GET_BIT(command, 2));
-	GPIO_writePin(DATA7, GET_BIT(command, 3));
+	GPIO_writePinGroup(&lcd_data_group, command & 0x0F);
 
 	delay_ms(1);
 	GPIO_writePin(E, LOGIC_LOW);
@@ -150,10 +152,8 @@ void LCD_init(void) {
 	GPIO_setupPinDirection(RS, PIN_OUTPUT);
 	GPIO_setupPinDirection(E, PIN_OUTPUT);
 	delay_ms(20); /* LCD Power ON delay always > 15ms */
-	GPIO_setupPinDirection(DATA4, PIN_OUTPUT);
-	GPIO_setupPinDirection(DATA5, PIN_OUTPUT);
-	GPIO_setupPinDirection(DATA6, PIN_OUTPUT);
-	GPIO_setupPinDirection(DATA7, PIN_OUTPUT);
+	GPIO_setupPinGroup(&lcd_data_group, lcd_data_pins, sizeof(lcd_data_pins));
+	GPIO_setupPinGroupDirection(&lcd_data_group, PIN_OUTPUT);
 	delay_ms(20);
 	LCD_sendCommand(LCD_COMMAND_RETURN_HOME);
 	LCD_sendCommand(LCD_COMMAND_4BIT_2Line_F0);
@@ -230,6 +230,10 @@ void LCD_moveCursor(uint8 row, uint8 col) {
 	case 3:
 		lcd_memory_address = col + 0x50;
 		break;
+	default:
+		/* No such row, stay on the first one */
+		lcd_memory_address = col;
+		break;
 	}
 	/* Move the LCD cursor to this specific address */
 	LCD_sendCommand(lcd_memory_address | LCD_COMMAND_SET_CURSOR_LOCATION);
@@ -238,12 +242,11 @@ void LCD_moveCursor(uint8 row, uint8 col) {
 /**
  * @brief Convert an integer to a string and display it on the LCD.
  *
- * @param data The integer to be displayed.
+ * @param data The integer to be displayed, in the signed 32-bit range.
  */
 void LCD_intgerToString(uint64 data) {
-	char buffer[10];
-	ltoa(data, buffer, 10);
-	LCD_displayString(buffer);
+	/* Digits go straight to the LCD, no string buffer to overflow */
+	FORMAT_print(LCD_displayCharacter, "%ld", (sint32) data);
 }
 
 /**
@@ -253,17 +256,18 @@ void LCD_intgerToString(uint64 data) {
  * @param percision The number of decimal places to display.
  */
 void LCD_floatToString(float data, uint8 percision) {
-	uint64 left, right, val;
-	uint8 i = 1;
-	val = 1;
-	left = (uint64) data;
+	sint32 val = 1;
+	uint8 i;
+
 	for (i = 1; i <= percision; i++) {
 		val *= 10;
 	}
-	right = (data - left) * val;
-	LCD_intgerToString(left);
-	LCD_displayCharacter('.');
-	LCD_intgerToString(right);
+	/*
+	 * Display as fixed point, this keeps the leading zeros of the decimals (1.05).
+	 * Round half away from zero, 1.05f * 100 is 104.99... and would truncate to 104.
+	 */
+	FORMAT_print(LCD_displayCharacter, "%.*lq", percision,
+			(sint32) ((data * val) + ((data < 0) ? -0.5f : 0.5f)));
 }
 
 /**
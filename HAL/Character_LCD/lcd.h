@@ -9,9 +9,9 @@
 #ifndef ATMEGA32_DRIVERS_LCD_H_
 #define ATMEGA32_DRIVERS_LCD_H_
 
-#include "..\..\std_types.h"
-#include "..\..\common_macros.h"
-#include "..\..\MCAL\gpio\gpio.h"
+#include "../../std_types.h"
+#include "../../common_macros.h"
+#include "../../MCAL/gpio/gpio.h"
 
 /*******************************************************************************
  *                                CONFIGURATIONS                               *
@@ -12,37 +12,39 @@
  */
 #include "dc.h"
 
+/**
+ * @brief Motor pins, bit i of the values below drives dc_motor_pins[i].
+ */
+static const uint8 dc_motor_pins[] = { MOTOR1A, MOTOR1B, ENABLE1 };
+
+#define DC_MOTOR_STOP_PINS  0b000 /* MOTOR1A = 0, MOTOR1B = 0, ENABLE1 = 0 */
+#define DC_MOTOR_CW_PINS    0b101 /* MOTOR1A = 1, MOTOR1B = 0, ENABLE1 = 1 */
+#define DC_MOTOR_CCW_PINS   0b110 /* MOTOR1A = 0, MOTOR1B = 1, ENABLE1 = 1 */
+
+/**
+ * @brief Pin group of the motor pins, all of them change in one port write.
+ */
+static GPIO_PinGroup dc_motor_group;
+
 void DcMOTOR_init(void) {
-	GPIO_setupPinDirection(MOTOR1A, PIN_OUTPUT);
-	GPIO_setupPinDirection(MOTOR1B, PIN_OUTPUT);
-	GPIO_setupPinDirection(ENABLE1, PIN_OUTPUT);
-	GPIO_writePin(MOTOR1A, LOGIC_LOW);
-	GPIO_writePin(MOTOR1B, LOGIC_LOW);
+	GPIO_setupPinGroup(&dc_motor_group, dc_motor_pins, sizeof(dc_motor_pins));
+	GPIO_setupPinGroupDirection(&dc_motor_group, PIN_OUTPUT);
+	GPIO_writePinGroup(&dc_motor_group, DC_MOTOR_STOP_PINS);
 
 }
 
 void DcMOTOR_Rotate(DcMOTOR_State rotateDirection) {
 
 	switch (rotateDirection) {
-	case STOP:
-		GPIO_writePin(MOTOR1A, LOGIC_LOW);
-		GPIO_writePin(MOTOR1B, LOGIC_LOW);
-		GPIO_writePin(ENABLE1, LOGIC_LOW);
-		break;
 	case CW:
-		GPIO_writePin(MOTOR1A, LOGIC_HIGH);
-		GPIO_writePin(MOTOR1B, LOGIC_LOW);
-		GPIO_writePin(ENABLE1, LOGIC_HIGH);
+		GPIO_writePinGroup(&dc_motor_group, DC_MOTOR_CW_PINS);
 		break;
 	case CCW:
-		GPIO_writePin(MOTOR1A, LOGIC_LOW);
-		GPIO_writePin(MOTOR1B, LOGIC_HIGH);
-		GPIO_writePin(ENABLE1, LOGIC_HIGH);
+		GPIO_writePinGroup(&dc_motor_group, DC_MOTOR_CCW_PINS);
 		break;
-
+	case STOP:
 	default:
-		GPIO_writePin(MOTOR1A, LOGIC_LOW);
-		GPIO_writePin(MOTOR1B, LOGIC_LOW);
+		GPIO_writePinGroup(&dc_motor_group, DC_MOTOR_STOP_PINS);
 		break;
 	}
 }
@@ -14,9 +14,9 @@
 #ifndef ATMEGA32_DRIVERS_HAL_DC_MOTOR_DC_H_
 #define ATMEGA32_DRIVERS_HAL_DC_MOTOR_DC_H_
 
-#include "..\..\std_types.h"
-#include "..\..\common_macros.h"
-#include "..\..\MCAL\gpio\gpio.h"
+#include "../../std_types.h"
+#include "../../common_macros.h"
+#include "../../MCAL/gpio/gpio.h"
 
 #define MOTOR1B B0
 #define MOTOR1A B1
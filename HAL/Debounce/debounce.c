@@ -0,0 +1,123 @@
+/******************************************************************************
+ *
+ * Module: HAL/DEBOUNCE
+ *
+ * File Name: debounce.c
+ *
+ * Description: Source File for the vertical-counter input debouncer
+ *
+ * Author: Mohamed Sayed
+ *
+ *******************************************************************************/
+#include "debounce.h"
+#include "../../MCAL/Atmega32_Registers.h"
+
+#if DEBOUNCE_SAMPLES != 4
+#error "The 2-bit vertical counters only support DEBOUNCE_SAMPLES = 4"
+#endif
+
+/*
+ * Per port state, bit n of every byte belongs to pin n:
+ * counter_low / counter_high : the two bits of the vertical counter
+ * state                      : the debounced pressed state
+ * pressed / released         : edges not read yet by the application
+ */
+static uint8 counter_low[NUM_OF_PORTS];
+static uint8 counter_high[NUM_OF_PORTS];
+static volatile uint8 state[NUM_OF_PORTS];
+static volatile uint8 pressed[NUM_OF_PORTS];
+static volatile uint8 released[NUM_OF_PORTS];
+
+/**
+ * @brief Read the port and convert it to pressed logic (1 = pressed).
+ */
+static uint8 DEBOUNCE_sample(uint8 port_num) {
+#if (DEBOUNCE_PRESSED_LEVEL == LOGIC_LOW)
+	return (uint8) ~GPIO_readPort(port_num);
+#else
+	return GPIO_readPort(port_num);
+#endif
+}
+
+void DEBOUNCE_init(void) {
+	uint8 port_num;
+
+	for (port_num = 0; port_num < NUM_OF_PORTS; port_num++) {
+		state[port_num] = DEBOUNCE_sample(port_num);
+		counter_low[port_num] = 0xFF;
+		counter_high[port_num] = 0xFF;
+		pressed[port_num] = 0;
+		released[port_num] = 0;
+	}
+}
+
+void DEBOUNCE_tick(void) {
+	uint8 port_num;
+	uint8 changed;
+	uint8 debounced;
+
+	for (port_num = 0; port_num < NUM_OF_PORTS; port_num++) {
+		/* Pins whose sample differs from the debounced state */
+		debounced = state[port_num];
+		changed = debounced ^ DEBOUNCE_sample(port_num);
+
+		/*
+		 * Count down the pins that differ, reload the others to 3:
+		 * 3 -> 2 -> 1 -> 0 -> (3 + toggle) after 4 differing samples.
+		 */
+		counter_low[port_num] = ~(counter_low[port_num] & changed);
+		counter_high[port_num] = counter_low[port_num]
+				^ (counter_high[port_num] & changed);
+
+		/* Pins that rolled over accept the new state */
+		changed &= counter_low[port_num] & counter_high[port_num];
+		debounced ^= changed;
+		state[port_num] = debounced;
+		pressed[port_num] |= debounced & changed;
+		released[port_num] |= (uint8) ~debounced & changed;
+	}
+}
+
+uint8 DEBOUNCE_getState(uint8 port_num) {
+	if (port_num >= NUM_OF_PORTS) {
+		return 0;
+	}
+	return state[port_num];
+}
+
+uint8 DEBOUNCE_getPressed(uint8 port_num) {
+	uint8 edges;
+	uint8 sreg;
+
+	if (port_num >= NUM_OF_PORTS) {
+		return 0;
+	}
+	/* Read and clear without losing an edge set by DEBOUNCE_tick in an ISR */
+	sreg = SREG;
+	GLOBAL_INTERRUPT_DISABLE();
+	edges = pressed[port_num];
+	pressed[port_num] = 0;
+	SREG = sreg;
+	return edges;
+}
+
+uint8 DEBOUNCE_getReleased(uint8 port_num) {
+	uint8 edges;
+	uint8 sreg;
+
+	if (port_num >= NUM_OF_PORTS) {
+		return 0;
+	}
+	/* Read and clear without losing an edge set by DEBOUNCE_tick in an ISR */
+	sreg = SREG;
+	GLOBAL_INTERRUPT_DISABLE();
+	edges = released[port_num];
+	released[port_num] = 0;
+	SREG = sreg;
+	return edges;
+}
+
+boolean DEBOUNCE_isPressed(uint8 pin_num) {
+	return GET_BIT(DEBOUNCE_getState(pin_num / NUM_OF_PINS_PER_PORT),
+			pin_num % NUM_OF_PINS_PER_PORT);
+}
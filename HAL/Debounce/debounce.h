@@ -0,0 +1,86 @@
+/******************************************************************************
+ *
+ * Module: HAL/DEBOUNCE
+ *
+ * File Name: debounce.h
+ *
+ * Description: Header File for the vertical-counter input debouncer
+ *
+ * Author: Mohamed Sayed
+ *
+ *******************************************************************************/
+#ifndef ATMEGA32_DRIVERS_DEBOUNCE_H_
+#define ATMEGA32_DRIVERS_DEBOUNCE_H_
+
+#include "../../std_types.h"
+#include "../../common_macros.h"
+#include "../../MCAL/gpio/gpio.h"
+
+/*******************************************************************************
+ *                                Description                                  *
+ *******************************************************************************
+ * All 32 pins are debounced in parallel: every tick reads each port once with
+ * GPIO_readPort and runs a 2-bit vertical counter per pin, stored bit-sliced in
+ * two bytes per port. A pin changes its debounced state only after it has read
+ * the new level on DEBOUNCE_SAMPLES (4) consecutive ticks, the cost per tick is a
+ * handful of logic instructions per port whatever the number of buttons.
+ *
+ * Call DEBOUNCE_tick periodically (5 - 10 ms is typical for push buttons), for
+ * example from a Timer0 callback, and read the results from the main loop.
+ *******************************************************************************/
+
+/*******************************************************************************
+ *                                CONFIGURATIONS                               *
+ *******************************************************************************/
+
+/**
+ * @brief Logic level of a pressed input (LOGIC_LOW for buttons with pull-ups).
+ */
+#define DEBOUNCE_PRESSED_LEVEL LOGIC_LOW
+
+/**
+ * @brief Number of equal consecutive samples needed to accept a new state.
+ */
+#define DEBOUNCE_SAMPLES 4
+
+/*******************************************************************************
+ *                                FUNCTIONS PROTOTYPE                          *
+ *******************************************************************************/
+
+/**
+ * @brief Load the current level of all the ports as the debounced state.
+ */
+void DEBOUNCE_init(void);
+
+/**
+ * @brief Sample all the ports and advance the vertical counters, call it periodically.
+ */
+void DEBOUNCE_tick(void);
+
+/**
+ * @brief Return the debounced pressed state of the port, bit n is 1 if pin n is pressed.
+ *
+ * @param port_num PORTA_ID..PORTD_ID
+ */
+uint8 DEBOUNCE_getState(uint8 port_num);
+
+/**
+ * @brief Return and clear the pins of the port that were pressed since the last call.
+ *
+ * @param port_num PORTA_ID..PORTD_ID
+ */
+uint8 DEBOUNCE_getPressed(uint8 port_num);
+
+/**
+ * @brief Return and clear the pins of the port that were released since the last call.
+ *
+ * @param port_num PORTA_ID..PORTD_ID
+ */
+uint8 DEBOUNCE_getReleased(uint8 port_num);
+
+/**
+ * @brief Return the debounced pressed state of a single pin (A0..D7).
+ */
+boolean DEBOUNCE_isPressed(uint8 pin_num);
+
+#endif /* ATMEGA32_DRIVERS_DEBOUNCE_H_ */
@@ -14,70 +14,74 @@
 
 #include "external_eeprom.h"
 #include "../../MCAL/Communication/I2C/twi.h"
+#include "../../delay.h"
 
-uint8 EEPROM_writeByte(uint16 u16addr, uint8 u8data) {
-	/* Send the Start Bit */
-	TWI_start();
-	if (TWI_getStatus() != TWI_START)
-		return ERROR;
+/* 7-bit device address, A10 A9 A8 of the memory location select the 256 byte block */
+#define EEPROM_DEVICE_ADDRESS(ADDR) ((uint8) (0x50 | (((ADDR) >> 8) & 0x07)))
 
-	/* Send the device address, we need to get A8 A9 A10 address bits from the
-	 * memory location address and R/W=0 (write) */
-	TWI_writeByte((uint8) (0xA0 | ((u16addr & 0x0700) >> 7)));
-	if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
+uint8 EEPROM_writeByte(uint16 u16addr, uint8 u8data) {
+	/* START, device address + W, memory location address, data, STOP */
+	if (TWI_writeRegs(EEPROM_DEVICE_ADDRESS(u16addr), (uint8) u16addr, &u8data, 1)
+			!= TWI_RESULT_OK)
 		return ERROR;
 
-	/* Send the required memory location address */
-	TWI_writeByte((uint8) (u16addr));
-	if (TWI_getStatus() != TWI_MT_DATA_ACK)
-		return ERROR;
+	return SUCCESS;
+}
 
-	/* write byte to eeprom */
-	TWI_writeByte(u8data);
-	if (TWI_getStatus() != TWI_MT_DATA_ACK)
+uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data) {
+	/* Memory location address written, then read after a repeated START */
+	if (TWI_readRegs(EEPROM_DEVICE_ADDRESS(u16addr), (uint8) u16addr, u8data, 1)
+			!= TWI_RESULT_OK)
 		return ERROR;
 
-	/* Send the Stop Bit */
-	TWI_stop();
-
 	return SUCCESS;
 }
 
-uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data) {
-	/* Send the Start Bit */
-	TWI_start();
-	if (TWI_getStatus() != TWI_START)
+uint8 EEPROM_readBlock(uint16 u16addr, uint8 *data, uint16 length) {
+	/* The address counter of a sequential read crosses the 256 byte blocks */
+	if (TWI_readRegs(EEPROM_DEVICE_ADDRESS(u16addr), (uint8) u16addr, data, length)
+			!= TWI_RESULT_OK)
 		return ERROR;
 
-	/* Send the device address, we need to get A8 A9 A10 address bits from the
-	 * memory location address and R/W=0 (write) */
-	TWI_writeByte((uint8) ((0xA0) | ((u16addr & 0x0700) >> 7)));
-	if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
-		return ERROR;
+	return SUCCESS;
+}
 
-	/* Send the required memory location address */
-	TWI_writeByte((uint8) (u16addr));
-	if (TWI_getStatus() != TWI_MT_DATA_ACK)
-		return ERROR;
+/*
+ * Description :
+ * Wait until the EEPROM ACKs its address again, it does not answer during the
+ * internal write cycle of the previous write.
+ */
+static uint8 EEPROM_waitReady(uint16 u16addr) {
+	uint8 tries;
 
-	/* Send the Repeated Start Bit */
-	TWI_start();
-	if (TWI_getStatus() != TWI_REP_START)
-		return ERROR;
+	for (tries = 0; tries < EEPROM_WRITE_POLL_LIMIT; tries++) {
+		if (TWI_transfer(EEPROM_DEVICE_ADDRESS(u16addr), NULL_PTR, 0, NULL_PTR, 0)
+				== TWI_RESULT_OK)
+			return SUCCESS;
+		delay_us(EEPROM_WRITE_POLL_US);
+	}
+	return ERROR;
+}
 
-	/* Send the device address, we need to get A8 A9 A10 address bits from the
-	 * memory location address and R/W=1 (Read) */
-	TWI_writeByte((uint8) ((0xA0) | ((u16addr & 0x0700) >> 7) | 1));
-	if (TWI_getStatus() != TWI_MT_SLA_R_ACK)
-		return ERROR;
+uint8 EEPROM_writeBlock(uint16 u16addr, const uint8 *data, uint16 length) {
+	uint16 chunk;
 
-	/* Read Byte from Memory without send ACK */
-	*u8data = TWI_readByteWithNACK();
-	if (TWI_getStatus() != TWI_MR_DATA_NACK)
-		return ERROR;
+	while (length != 0) {
+		/* A page write wraps inside its page, so split at the page boundaries */
+		chunk = EEPROM_PAGE_SIZE - (u16addr & (EEPROM_PAGE_SIZE - 1));
+		if (chunk > length)
+			chunk = length;
+
+		if (EEPROM_waitReady(u16addr) == ERROR)
+			return ERROR;
+		if (TWI_writeRegs(EEPROM_DEVICE_ADDRESS(u16addr), (uint8) u16addr, data, chunk)
+				!= TWI_RESULT_OK)
+			return ERROR;
 
-	/* Send the Stop Bit */
-	TWI_stop();
+		u16addr += chunk;
+		data += chunk;
+		length -= chunk;
+	}
 
 	return SUCCESS;
 }
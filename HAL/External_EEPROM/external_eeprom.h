@@ -15,7 +15,7 @@
 #ifndef EXTERNAL_EEPROM_H_
 #define EXTERNAL_EEPROM_H_
 
-#include "..\..\std_types.h"
+#include "../../std_types.h"
 
 /*******************************************************************************
  *                      Preprocessor Macros                                    *
@@ -23,6 +23,13 @@
 #define ERROR 0
 #define SUCCESS 1
 
+/* Page write buffer of the 24C16, a write never crosses a page */
+#define EEPROM_PAGE_SIZE 16
+
+/* Address polls of EEPROM_writeBlock before giving up, EEPROM_WRITE_POLL_US apart */
+#define EEPROM_WRITE_POLL_LIMIT 100
+#define EEPROM_WRITE_POLL_US 100
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
@@ -30,4 +37,18 @@
 uint8 EEPROM_writeByte(uint16 u16addr, uint8 u8data);
 uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data);
 
+/*
+ * Description :
+ * Sequential read of length bytes from u16addr in one transfer.
+ */
+uint8 EEPROM_readBlock(uint16 u16addr, uint8 *data, uint16 length);
+
+/*
+ * Description :
+ * Write length bytes from u16addr with page writes, waiting for the write cycle of
+ * the previous page by polling the device address (up to 10 ms). The last page is
+ * still being written when it returns, like after EEPROM_writeByte.
+ */
+uint8 EEPROM_writeBlock(uint16 u16addr, const uint8 *data, uint16 length);
+
 #endif /* EXTERNAL_EEPROM_H_ */
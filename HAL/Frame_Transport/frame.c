@@ -0,0 +1,318 @@
+/******************************************************************************
+ *
+ * Module: HAL/FRAME
+ *
+ * File Name: frame.c
+ *
+ * Description: Source file for the COBS + CRC16 binary framing over UART
+ *
+ * Author: Mohamed Sayed
+ *
+ *******************************************************************************/
+
+#include "frame.h"
+#include "../../MCAL/Communication/UART/uart.h"
+#include "../../MCAL/Atmega32_Registers.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define FRAME_STATE_RECEIVING  0
+#define FRAME_STATE_DISCARDING 1 /* too long, waiting for the next delimiter */
+#define FRAME_STATE_READY      2 /* valid frame, owned by the application */
+
+/* seq byte + CRC bytes around the payload */
+#define FRAME_HEADER_SIZE 1
+#define FRAME_CRC_SIZE    2
+
+/*
+ * COBS encoder state: position of the pending code byte and its current value.
+ */
+typedef struct {
+	uint8 *out;
+	uint16 code_index;
+	uint16 length;
+	uint8 code;
+} FRAME_CobsEncoder;
+
+/*******************************************************************************
+ *                              Private Variables                              *
+ *******************************************************************************/
+
+/* CRC-16/CCITT-FALSE of one nibble, (i << 12) shifted through the polynomial 0x1021 */
+static const uint16 frame_crc_table[16] = { 0x0000, 0x1021, 0x2042, 0x3063,
+		0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C,
+		0xD1AD, 0xE1CE, 0xF1EF };
+
+static uint8 frame_tx_seq = 0;
+
+/*******************************************************************************
+ *                              Private Functions                              *
+ *******************************************************************************/
+
+static void FRAME_cobsStart(FRAME_CobsEncoder *encoder, uint8 *out) {
+	encoder->out = out;
+	encoder->code_index = 0;
+	encoder->length = 1;
+	encoder->code = 1;
+}
+
+/*
+ * Description :
+ * Add one byte, a zero (or a full 254 byte block) closes the current block.
+ */
+static void FRAME_cobsPut(FRAME_CobsEncoder *encoder, uint8 data) {
+	if (data != 0) {
+		encoder->out[encoder->length] = data;
+		encoder->length++;
+		encoder->code++;
+	}
+	if ((data == 0) || (encoder->code == 0xFF)) {
+		encoder->out[encoder->code_index] = encoder->code;
+		encoder->code_index = encoder->length;
+		encoder->length++;
+		encoder->code = 1;
+	}
+}
+
+/*
+ * Description :
+ * Close the last block and add the delimiter, return the total length.
+ */
+static uint16 FRAME_cobsEnd(FRAME_CobsEncoder *encoder) {
+	encoder->out[encoder->code_index] = encoder->code;
+	encoder->out[encoder->length] = 0;
+	return encoder->length + 1;
+}
+
+static void FRAME_count(volatile uint16 *counter) {
+	if (*counter != 0xFFFF) {
+		(*counter)++;
+	}
+}
+
+static void FRAME_countMany(volatile uint16 *counter, uint8 count) {
+	uint32 sum = (uint32) *counter + count;
+
+	*counter = (sum > 0xFFFF) ? 0xFFFF : (uint16) sum;
+}
+
+static uint16 FRAME_readCounter(const volatile uint16 *counter) {
+	uint8 sreg = SREG;
+	uint16 value;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	value = *counter;
+	SREG = sreg;
+	return value;
+}
+
+/*
+ * Description :
+ * Decode and check the bytes received up to the delimiter.
+ * Return TRUE if the receiver holds a valid frame.
+ */
+static boolean FRAME_check(FRAME_Receiver *receiver) {
+	uint16 length = FRAME_decode(receiver->buffer, receiver->length);
+	uint16 crc;
+	uint8 seq;
+
+	if (length < (FRAME_HEADER_SIZE + FRAME_CRC_SIZE + 1)) {
+		FRAME_count(&receiver->format_errors);
+		return FALSE;
+	}
+
+	length -= FRAME_CRC_SIZE;
+	crc = FRAME_crc16(0xFFFF, receiver->buffer, length);
+	if ((receiver->buffer[length] != (uint8) crc)
+			|| (receiver->buffer[length + 1] != (uint8) (crc >> 8))) {
+		FRAME_count(&receiver->crc_errors);
+		return FALSE;
+	}
+
+	/*
+	 * Every sequence number skipped since the last valid frame is a lost frame. A
+	 * repeat of the last one (resent or replayed frame) is a duplicate, not a gap
+	 * of 255 frames.
+	 */
+	seq = receiver->buffer[0];
+	if (receiver->synchronized && (seq != (uint8) (receiver->expected_seq - 1))) {
+		FRAME_countMany(&receiver->lost_frames, (uint8) (seq - receiver->expected_seq));
+	}
+	receiver->expected_seq = seq + 1;
+	receiver->synchronized = TRUE;
+
+	receiver->length = length;
+	return TRUE;
+}
+
+/*******************************************************************************
+ *                              Functions Definitions                          *
+ *******************************************************************************/
+
+uint16 FRAME_crc16(uint16 crc, const uint8 *data, uint16 length) {
+	uint16 i;
+
+	for (i = 0; i < length; i++) {
+		crc = (crc << 4) ^ frame_crc_table[(crc >> 12) ^ (data[i] >> 4)];
+		crc = (crc << 4) ^ frame_crc_table[(crc >> 12) ^ (data[i] & 0x0F)];
+	}
+	return crc;
+}
+
+uint16 FRAME_encode(uint8 seq, const uint8 *payload, uint16 length, uint8 *out) {
+	FRAME_CobsEncoder encoder;
+	uint16 crc;
+	uint16 i;
+
+	crc = FRAME_crc16(0xFFFF, &seq, 1);
+	crc = FRAME_crc16(crc, payload, length);
+
+	FRAME_cobsStart(&encoder, out);
+	FRAME_cobsPut(&encoder, seq);
+	for (i = 0; i < length; i++) {
+		FRAME_cobsPut(&encoder, payload[i]);
+	}
+	FRAME_cobsPut(&encoder, (uint8) crc);
+	FRAME_cobsPut(&encoder, (uint8) (crc >> 8));
+	return FRAME_cobsEnd(&encoder);
+}
+
+uint16 FRAME_decode(uint8 *buffer, uint16 length) {
+	uint16 read = 0;
+	uint16 write = 0;
+	uint8 code;
+	uint8 i;
+
+	/* The output never passes the input, so decoding in place is safe */
+	while (read < length) {
+		code = buffer[read];
+		read++;
+		if (code == 0) {
+			return 0;
+		}
+		for (i = 1; i < code; i++) {
+			if ((read >= length) || (buffer[read] == 0)) {
+				return 0;
+			}
+			buffer[write] = buffer[read];
+			write++;
+			read++;
+		}
+		/* A block shorter than 254 bytes stood for a zero, except the last one */
+		if ((code != 0xFF) && (read < length)) {
+			buffer[write] = 0;
+			write++;
+		}
+	}
+	return write;
+}
+
+void FRAME_send(const uint8 *payload, uint16 length) {
+	static uint8 frame[FRAME_ENCODED_SIZE(FRAME_MAX_PAYLOAD)];
+	uint16 frame_length;
+	uint16 i;
+
+	if ((length == 0) || (length > FRAME_MAX_PAYLOAD)) {
+		return;
+	}
+
+	frame_length = FRAME_encode(frame_tx_seq, payload, length, frame);
+	frame_tx_seq++;
+
+	for (i = 0; i < frame_length; i++) {
+		UART_sendByte(frame[i]);
+	}
+}
+
+void FRAME_initReceiver(FRAME_Receiver *receiver, uint8 *buffer, uint16 size) {
+	receiver->buffer = buffer;
+	receiver->size = size;
+	receiver->length = 0;
+	receiver->state = FRAME_STATE_RECEIVING;
+	receiver->expected_seq = 0;
+	receiver->synchronized = FALSE;
+	receiver->crc_errors = 0;
+	receiver->format_errors = 0;
+	receiver->lost_frames = 0;
+	receiver->dropped = 0;
+}
+
+FRAME_Status FRAME_feed(FRAME_Receiver *receiver, uint8 data) {
+	if (receiver->state == FRAME_STATE_READY) {
+		/* The buffer still holds the previous frame, nowhere to put the byte */
+		FRAME_count(&receiver->dropped);
+		return FRAME_READY;
+	}
+
+	if (data != 0) {
+		if (receiver->state == FRAME_STATE_DISCARDING) {
+			return FRAME_ERROR;
+		}
+		if (receiver->length >= receiver->size) {
+			FRAME_count(&receiver->format_errors);
+			receiver->state = FRAME_STATE_DISCARDING;
+			return FRAME_ERROR;
+		}
+		receiver->buffer[receiver->length] = data;
+		receiver->length++;
+		return FRAME_ACCEPTED;
+	}
+
+	/* Delimiter: end of frame, or of the discarded bytes, or idle line filler */
+	if ((receiver->state == FRAME_STATE_DISCARDING) || (receiver->length == 0)) {
+		receiver->state = FRAME_STATE_RECEIVING;
+		receiver->length = 0;
+		return FRAME_ACCEPTED;
+	}
+	if (FRAME_check(receiver)) {
+		receiver->state = FRAME_STATE_READY;
+		return FRAME_READY;
+	}
+	receiver->length = 0;
+	return FRAME_ERROR;
+}
+
+FRAME_Status FRAME_pollUart(FRAME_Receiver *receiver) {
+	uint8 data;
+
+	while (receiver->state != FRAME_STATE_READY) {
+		if (UART_read(&data, 1) == 0) {
+			return FRAME_ACCEPTED;
+		}
+		FRAME_feed(receiver, data);
+	}
+	return FRAME_READY;
+}
+
+uint16 FRAME_getPayload(FRAME_Receiver *receiver, const uint8 **payload,
+		uint8 *seq) {
+	if (receiver->state != FRAME_STATE_READY) {
+		return 0;
+	}
+	*payload = &receiver->buffer[FRAME_HEADER_SIZE];
+	*seq = receiver->buffer[0];
+	return receiver->length - FRAME_HEADER_SIZE;
+}
+
+void FRAME_release(FRAME_Receiver *receiver) {
+	receiver->length = 0;
+	receiver->state = FRAME_STATE_RECEIVING;
+}
+
+uint16 FRAME_getCrcErrorCount(const FRAME_Receiver *receiver) {
+	return FRAME_readCounter(&receiver->crc_errors);
+}
+
+uint16 FRAME_getFormatErrorCount(const FRAME_Receiver *receiver) {
+	return FRAME_readCounter(&receiver->format_errors);
+}
+
+uint16 FRAME_getLostFrameCount(const FRAME_Receiver *receiver) {
+	return FRAME_readCounter(&receiver->lost_frames);
+}
+
+uint16 FRAME_getDroppedCount(const FRAME_Receiver *receiver) {
+	return FRAME_readCounter(&receiver->dropped);
+}
@@ -8,7 +8,7 @@
 #ifndef ATMEGA32_DRIVERS_LED_H
 #define ATMEGA32_DRIVERS_LED_H
 
-#include "../../std_types.h.."
+#include "../../std_types.h"
 
 /**
  * @struct LED
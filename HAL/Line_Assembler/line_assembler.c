@@ -0,0 +1,187 @@
+/******************************************************************************
+ *
+ * Module: HAL/LINE
+ *
+ * File Name: line_assembler.c
+ *
+ * Description: Source file for the bounded, non-blocking line/packet assembler
+ *
+ * Author: Mohamed Sayed
+ *
+ *******************************************************************************/
+
+#include "line_assembler.h"
+#include "../../MCAL/Communication/UART/uart.h"
+#include "../../MCAL/Atmega32_Registers.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define LINE_STATE_RECEIVING  0
+#define LINE_STATE_DISCARDING 1 /* too long, waiting for the next delimiter */
+#define LINE_STATE_READY      2 /* frame complete, owned by the application */
+
+/*******************************************************************************
+ *                              Private Functions                              *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return TRUE if data is one of the delimiter characters.
+ */
+static boolean LINE_isDelimiter(const LINE_Assembler *line, uint8 data) {
+	const uint8 *delimiter;
+
+	for (delimiter = line->delimiters; *delimiter != '\0'; delimiter++) {
+		if (*delimiter == data) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Increment a counter without wrapping back to zero.
+ */
+static void LINE_count(volatile uint16 *counter) {
+	if (*counter != 0xFFFF) {
+		(*counter)++;
+	}
+}
+
+/*
+ * Description :
+ * Read a 16-bit counter updated from an ISR.
+ */
+static uint16 LINE_readCounter(const volatile uint16 *counter) {
+	uint8 sreg = SREG;
+	uint16 value;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	value = *counter;
+	SREG = sreg;
+	return value;
+}
+
+/*******************************************************************************
+ *                              Functions Definitions                          *
+ *******************************************************************************/
+
+void LINE_init(LINE_Assembler *line, uint8 *buffer, uint16 size,
+		const uint8 *delimiters, uint8 timeout_ticks) {
+	line->buffer = buffer;
+	line->size = size;
+	line->delimiters = delimiters;
+	line->length = 0;
+	line->state = LINE_STATE_RECEIVING;
+	line->timeout_ticks = timeout_ticks;
+	line->idle_ticks = 0;
+	line->overflows = 0;
+	line->timeouts = 0;
+	line->dropped = 0;
+}
+
+LINE_Status LINE_feed(LINE_Assembler *line, uint8 data) {
+	LINE_Status status = LINE_ACCEPTED;
+	uint8 sreg = SREG;
+
+	/* LINE_tick may run from a timer ISR while the main loop feeds bytes */
+	GLOBAL_INTERRUPT_DISABLE();
+
+	if (line->state == LINE_STATE_READY) {
+		/* The buffer still holds the previous frame, nowhere to put the byte */
+		LINE_count(&line->dropped);
+		status = LINE_FRAME_READY;
+	} else if (LINE_isDelimiter(line, data)) {
+		if (line->state == LINE_STATE_DISCARDING) {
+			/* End of the too long frame, start over */
+			line->state = LINE_STATE_RECEIVING;
+			line->length = 0;
+		} else if (line->length != 0) {
+			line->buffer[line->length] = '\0';
+			line->state = LINE_STATE_READY;
+			status = LINE_FRAME_READY;
+		}
+	} else if (line->state == LINE_STATE_DISCARDING) {
+		status = LINE_OVERFLOW;
+	} else if (line->length < (line->size - 1)) {
+		line->buffer[line->length] = data;
+		line->length++;
+	} else {
+		/* Keep room for the '\0', drop the frame up to the next delimiter */
+		LINE_count(&line->overflows);
+		line->state = LINE_STATE_DISCARDING;
+		status = LINE_OVERFLOW;
+	}
+	line->idle_ticks = 0;
+
+	SREG = sreg;
+	return status;
+}
+
+LINE_Status LINE_pollUart(LINE_Assembler *line) {
+	uint8 data;
+
+	while (line->state != LINE_STATE_READY) {
+		if (UART_read(&data, 1) == 0) {
+			return LINE_ACCEPTED;
+		}
+		LINE_feed(line, data);
+	}
+	return LINE_FRAME_READY;
+}
+
+void LINE_tick(LINE_Assembler *line) {
+	uint8 sreg;
+
+	if (line->timeout_ticks == 0) {
+		return;
+	}
+
+	sreg = SREG;
+	GLOBAL_INTERRUPT_DISABLE();
+	if ((line->state != LINE_STATE_READY)
+			&& ((line->length != 0) || (line->state == LINE_STATE_DISCARDING))) {
+		line->idle_ticks++;
+		if (line->idle_ticks >= line->timeout_ticks) {
+			/* The rest of the frame never came, forget the partial frame */
+			LINE_count(&line->timeouts);
+			line->length = 0;
+			line->state = LINE_STATE_RECEIVING;
+			line->idle_ticks = 0;
+		}
+	}
+	SREG = sreg;
+}
+
+uint16 LINE_getFrame(LINE_Assembler *line, const uint8 **frame) {
+	if (line->state != LINE_STATE_READY) {
+		return 0;
+	}
+	*frame = line->buffer;
+	return line->length;
+}
+
+void LINE_release(LINE_Assembler *line) {
+	uint8 sreg = SREG;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	line->length = 0;
+	line->idle_ticks = 0;
+	line->state = LINE_STATE_RECEIVING;
+	SREG = sreg;
+}
+
+uint16 LINE_getOverflowCount(const LINE_Assembler *line) {
+	return LINE_readCounter(&line->overflows);
+}
+
+uint16 LINE_getTimeoutCount(const LINE_Assembler *line) {
+	return LINE_readCounter(&line->timeouts);
+}
+
+uint16 LINE_getDroppedCount(const LINE_Assembler *line) {
+	return LINE_readCounter(&line->dropped);
+}
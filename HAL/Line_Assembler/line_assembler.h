@@ -0,0 +1,134 @@
+/******************************************************************************
+ *
+ * Module: HAL/LINE
+ *
+ * File Name: line_assembler.h
+ *
+ * Description: Header File for the bounded, non-blocking line/packet assembler
+ *
+ * Author: Mohamed Sayed
+ *
+ *******************************************************************************/
+#ifndef ATMEGA32_DRIVERS_LINE_ASSEMBLER_H_
+#define ATMEGA32_DRIVERS_LINE_ASSEMBLER_H_
+
+#include "../../std_types.h"
+
+/*******************************************************************************
+ *                                Description                                  *
+ *******************************************************************************
+ * The assembler collects received bytes one at a time into a buffer given by the
+ * caller, until one of the delimiter characters arrives. The frame is then handed
+ * over in place (no copy) and the assembler refuses new bytes until the frame is
+ * released, so it never blocks and never writes past the buffer:
+ *
+ *     static uint8 buffer[32];
+ *     static LINE_Assembler line;
+ *
+ *     LINE_init(&line, buffer, sizeof(buffer), (const uint8*) "\r\n", 20);
+ *     ...
+ *     if (LINE_pollUart(&line) == LINE_FRAME_READY) {
+ *         length = LINE_getFrame(&line, &frame);
+ *         ... use frame[0..length - 1], frame[length] is '\0' ...
+ *         LINE_release(&line);
+ *     }
+ *
+ * Feeding:
+ *  - from the main loop with LINE_pollUart, which reads the UART without waiting
+ *    and leaves the bytes in the UART while a frame is pending, or
+ *  - from the RX interrupt with UART_setReceiveCallback and a callback that calls
+ *    LINE_feed (bytes arriving while a frame is pending are dropped and counted).
+ *
+ * Timeout: call LINE_tick periodically, for example from a Timer0 callback. A
+ * partial frame with no new byte for timeout_ticks ticks is discarded, so a lost
+ * delimiter does not glue two commands together.
+ *
+ * Empty frames (two delimiters in a row, like "\r\n") are skipped. A frame longer
+ * than size - 1 bytes is discarded up to the next delimiter.
+ *******************************************************************************/
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Result of feeding a byte.
+ */
+typedef enum {
+	LINE_ACCEPTED, /* byte stored or skipped, the frame is not complete */
+	LINE_FRAME_READY, /* a frame is complete and waits for LINE_release */
+	LINE_OVERFLOW, /* the frame is too long, it is discarded */
+} LINE_Status;
+
+/*
+ * Assembler state, the fields are private to line_assembler.c.
+ */
+typedef struct {
+	uint8 *buffer;
+	uint16 size;
+	const uint8 *delimiters;
+	volatile uint16 length;
+	volatile uint8 state;
+	uint8 timeout_ticks;
+	volatile uint8 idle_ticks;
+	volatile uint16 overflows;
+	volatile uint16 timeouts;
+	volatile uint16 dropped;
+} LINE_Assembler;
+
+/*******************************************************************************
+ *                                FUNCTIONS PROTOTYPE                          *
+ *******************************************************************************/
+
+/**
+ * @brief Initialize the assembler with the caller storage.
+ *
+ * @param line The assembler.
+ * @param buffer Frame storage, the frames are at most size - 1 bytes plus '\0'.
+ * @param size Size of buffer in bytes (2 or more).
+ * @param delimiters '\0' terminated set of the characters that end a frame.
+ * @param timeout_ticks Inter-byte timeout in LINE_tick periods, 0 to disable it.
+ */
+void LINE_init(LINE_Assembler *line, uint8 *buffer, uint16 size,
+		const uint8 *delimiters, uint8 timeout_ticks);
+
+/**
+ * @brief Add one received byte, can be called from an ISR.
+ *
+ * @return LINE_FRAME_READY when a frame is complete or already pending.
+ */
+LINE_Status LINE_feed(LINE_Assembler *line, uint8 data);
+
+/**
+ * @brief Read the available UART bytes without waiting and feed them, stops at
+ * the end of a frame so the next bytes stay in the UART.
+ */
+LINE_Status LINE_pollUart(LINE_Assembler *line);
+
+/**
+ * @brief Advance the inter-byte timeout, call it periodically.
+ */
+void LINE_tick(LINE_Assembler *line);
+
+/**
+ * @brief Get the pending frame in place.
+ *
+ * @param frame Set to the first byte of the frame, it stays valid until LINE_release.
+ * @return The frame length, 0 if no frame is pending.
+ */
+uint16 LINE_getFrame(LINE_Assembler *line, const uint8 **frame);
+
+/**
+ * @brief Give the buffer back to the assembler after using the frame.
+ */
+void LINE_release(LINE_Assembler *line);
+
+/**
+ * @brief Return the number of frames discarded as too long / timed out, and the
+ * bytes dropped while a frame was pending.
+ */
+uint16 LINE_getOverflowCount(const LINE_Assembler *line);
+uint16 LINE_getTimeoutCount(const LINE_Assembler *line);
+uint16 LINE_getDroppedCount(const LINE_Assembler *line);
+
+#endif /* ATMEGA32_DRIVERS_LINE_ASSEMBLER_H_ */
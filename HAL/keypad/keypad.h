@@ -11,9 +11,9 @@
  *******************************************************************************/
 #ifndef ATMEGA32_DRIVERS_KEYBAD_H_
 #define ATMEGA32_DRIVERS_KEYBAD_H_
-#include "..\..\std_types.h"
-#include "..\..\common_macros.h"
-#include "..\..\MCAL\gpio\gpio.h"
+#include "../../std_types.h"
+#include "../../common_macros.h"
+#include "../../MCAL/gpio/gpio.h"
 /*******************************************************************************
  *                                CONFIGURATIONS                               *
  *******************************************************************************/
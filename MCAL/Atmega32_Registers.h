@@ -8,93 +8,141 @@
 #ifndef ATMEGA32_ETAMINI_ATMEGA32_REGISTERS_H
 #define ATMEGA32_ETAMINI_ATMEGA32_REGISTERS_H
 
-#define SREG (*(volatile uint8 *)((0x3F) + 0x20))
-
-#define SP (*(volatile uint16 *)((0x3D) + 0x20))
-#define SPH (*(volatile uint8 *)((0x3E) + 0x20))
-#define SPL (*(volatile uint8 *)((0x3D) + 0x20))
-
-#define OCR0 (*(volatile uint8 *)((0x3C) + 0x20))
-#define GICR (*(volatile uint8 *)((0x3B) + 0x20))
-#define GIFR (*(volatile uint8 *)((0x3A) + 0x20))
-#define TIMSK (*(volatile uint8 *)((0x39) + 0x20))
-#define TIFR (*(volatile uint8 *)((0x38) + 0x20))
-#define SPMCR (*(volatile uint8 *)((0x37) + 0x20))
-#define TWCR (*(volatile uint8 *)((0x36) + 0x20))
-#define MCUCR (*(volatile uint8 *)((0x35) + 0x20))
-#define MCUCSR (*(volatile uint8 *)((0x34) + 0x20))
-#define TCCR0 (*(volatile uint8 *)((0x33) + 0x20))
-#define TCNT0 (*(volatile uint8 *)((0x32) + 0x20))
-#define OSCCAL (*(volatile uint8 *)((0x31) + 0x20))
-#define OCDR (*(volatile uint8 *)((0x31) + 0x20))
-#define SFIOR (*(volatile uint8 *)((0x30) + 0x20))
-#define TCCR1A (*(volatile uint8 *)((0x2F) + 0x20))
-#define TCCR1B (*(volatile uint8 *)((0x2E) + 0x20))
-
-#define TCNT1 (*(volatile uint16 *)((0x2C) + 0x20))
-#define TCNT1H (*(volatile uint8 *)((0x2D) + 0x20))
-#define TCNT1L (*(volatile uint8 *)((0x2C) + 0x20))
-
-#define OCR1A   (*(volatile uint16 *)((0x2A) + 0x20))
-#define OCR1AH (*(volatile uint8 *)((0x2B) + 0x20))
-#define OCR1AL (*(volatile uint8 *)((0x2A) + 0x20))
-
-#define OCR1B (*(volatile uint16 *)((0x28) + 0x20))
-#define OCR1BH (*(volatile uint8 *)((0x29) + 0x20))
-#define OCR1BL (*(volatile uint8 *)((0x28) + 0x20))
-
-#define  ICR1 (*(volatile uint16 *)((0x26) + 0x20))
-#define ICR1H (*(volatile uint8 *)((0x27) + 0x20))
-#define ICR1L (*(volatile uint8 *)((0x26) + 0x20))
-
-#define TCCR2 (*(volatile uint8 *)((0x25) + 0x20))
-#define TCNT2 (*(volatile uint8 *)((0x24) + 0x20))
-#define OCR2 (*(volatile uint8 *)((0x23) + 0x20))
-#define ASSR (*(volatile uint8 *)((0x22) + 0x20))
-#define WDTCR (*(volatile uint8 *)((0x21) + 0x20))
-#define UBRRH (*(volatile uint8 *)((0x20) + 0x20))
-#define UCSRC (*(volatile uint8 *)((0x20) + 0x20))
-
-#define EEAR  (*(volatile uint16 *)((0x1E) + 0x20))
-#define EEARH (*(volatile uint8 *)((0x1F) + 0x20))
-#define EEARL (*(volatile uint8 *)((0x1E) + 0x20))
-
-#define EEDR (*(volatile uint8 *)((0x1D) + 0x20))
-#define EECR (*(volatile uint8 *)((0x1C) + 0x20))
-#define PORTA (*(volatile uint8 *)((0x1B) + 0x20))
-#define DDRA (*(volatile uint8 *)((0x1A) + 0x20))
-#define PINA (*(volatile uint8 *)((0x19) + 0x20))
-#define PORTB (*(volatile uint8 *)((0x18) + 0x20))
-#define DDRB (*(volatile uint8 *)((0x17) + 0x20))
-#define PINB (*(volatile uint8 *)((0x16) + 0x20))
-#define PORTC (*(volatile uint8 *)((0x15) + 0x20))
-#define DDRC (*(volatile uint8 *)((0x14) + 0x20))
-#define PINC (*(volatile uint8 *)((0x13) + 0x20))
-#define PORTD (*(volatile uint8 *)((0x12) + 0x20))
-#define DDRD (*(volatile uint8 *)((0x11) + 0x20))
-#define PIND (*(volatile uint8 *)((0x10) + 0x20))
-#define SPDR (*(volatile uint8 *)((0x0F) + 0x20))
-#define SPCR (*(volatile uint8 *)((0x0D) + 0x20))
-
-#define SPSR (*(volatile uint8 *)((0x0E) + 0x20))
-#define UDR (*(volatile uint8 *)((0x0C) + 0x20))
-#define UCSRA (*(volatile uint8 *)((0x0B) + 0x20))
-#define UCSRB (*(volatile uint8 *)((0x0A) + 0x20))
-#define UBRRL (*(volatile uint8 *)((0x09) + 0x20))
-#define ACSR (*(volatile uint8 *)((0x08) + 0x20))
-#define ADMUX (*(volatile uint8 *)((0x07) + 0x20))
-#define ADCSRA (*(volatile uint8 *)((0x06) + 0x20))
-
-#define ADC (*(volatile uint16 *)((0x04) + 0x20))
-#define ADCH (*(volatile uint8 *)((0x05) + 0x20))
-#define ADCL (*(volatile uint8 *)((0x04) + 0x20))
-
-#define TWDR (*(volatile uint8 *)((0x03) + 0x20))
-#define TWAR (*(volatile uint8 *)((0x02) + 0x20))
-#define TWSR (*(volatile uint8 *)((0x01) + 0x20))
-#define TWBR (*(volatile uint8 *)((0x00) + 0x20))
+/*
+ * Register access, the argument is the data-space address of the register.
+ * With HOST_BUILD defined the registers are served by the simulated peripheral model
+ * in MCAL/Host_Model, so the drivers compile and run unmodified on the host.
+ */
+#if defined (HOST_BUILD)
+#include "Host_Model/host_model.h"
+#define IO_REG8(ADDRESS) (*HOST_register8(ADDRESS))
+#define IO_REG16(ADDRESS) (*HOST_register16(ADDRESS))
+#else
+#define IO_REG8(ADDRESS) (*(volatile uint8 *)(ADDRESS))
+#define IO_REG16(ADDRESS) (*(volatile uint16 *)(ADDRESS))
+#endif
+
+#define SREG IO_REG8((0x3F) + 0x20)
+
+#define SP IO_REG16((0x3D) + 0x20)
+#define SPH IO_REG8((0x3E) + 0x20)
+#define SPL IO_REG8((0x3D) + 0x20)
+
+/* Last internal SRAM address, the stack starts here */
+#define RAMEND 0x085F
+
+#define OCR0 IO_REG8((0x3C) + 0x20)
+#define GICR IO_REG8((0x3B) + 0x20)
+#define GIFR IO_REG8((0x3A) + 0x20)
+#define TIMSK IO_REG8((0x39) + 0x20)
+#define TIFR IO_REG8((0x38) + 0x20)
+#define SPMCR IO_REG8((0x37) + 0x20)
+#define TWCR IO_REG8((0x36) + 0x20)
+#define MCUCR IO_REG8((0x35) + 0x20)
+#define MCUCSR IO_REG8((0x34) + 0x20)
+#define TCCR0 IO_REG8((0x33) + 0x20)
+#define TCNT0 IO_REG8((0x32) + 0x20)
+#define OSCCAL IO_REG8((0x31) + 0x20)
+#define OCDR IO_REG8((0x31) + 0x20)
+#define SFIOR IO_REG8((0x30) + 0x20)
+#define TCCR1A IO_REG8((0x2F) + 0x20)
+#define TCCR1B IO_REG8((0x2E) + 0x20)
+
+#define TCNT1 IO_REG16((0x2C) + 0x20)
+#define TCNT1H IO_REG8((0x2D) + 0x20)
+#define TCNT1L IO_REG8((0x2C) + 0x20)
+
+#define OCR1A   IO_REG16((0x2A) + 0x20)
+#define OCR1AH IO_REG8((0x2B) + 0x20)
+#define OCR1AL IO_REG8((0x2A) + 0x20)
+
+#define OCR1B IO_REG16((0x28) + 0x20)
+#define OCR1BH IO_REG8((0x29) + 0x20)
+#define OCR1BL IO_REG8((0x28) + 0x20)
+
+#define  ICR1 IO_REG16((0x26) + 0x20)
+#define ICR1H IO_REG8((0x27) + 0x20)
+#define ICR1L IO_REG8((0x26) + 0x20)
+
+#define TCCR2 IO_REG8((0x25) + 0x20)
+#define TCNT2 IO_REG8((0x24) + 0x20)
+#define OCR2 IO_REG8((0x23) + 0x20)
+#define ASSR IO_REG8((0x22) + 0x20)
+#define WDTCR IO_REG8((0x21) + 0x20)
+#define UBRRH IO_REG8((0x20) + 0x20)
+#define UCSRC IO_REG8((0x20) + 0x20)
+
+#define EEAR  IO_REG16((0x1E) + 0x20)
+#define EEARH IO_REG8((0x1F) + 0x20)
+#define EEARL IO_REG8((0x1E) + 0x20)
+
+#define EEDR IO_REG8((0x1D) + 0x20)
+#define EECR IO_REG8((0x1C) + 0x20)
+#define PORTA IO_REG8((0x1B) + 0x20)
+#define DDRA IO_REG8((0x1A) + 0x20)
+#define PINA IO_REG8((0x19) + 0x20)
+#define PORTB IO_REG8((0x18) + 0x20)
+#define DDRB IO_REG8((0x17) + 0x20)
+#define PINB IO_REG8((0x16) + 0x20)
+#define PORTC IO_REG8((0x15) + 0x20)
+#define DDRC IO_REG8((0x14) + 0x20)
+#define PINC IO_REG8((0x13) + 0x20)
+#define PORTD IO_REG8((0x12) + 0x20)
+#define DDRD IO_REG8((0x11) + 0x20)
+#define PIND IO_REG8((0x10) + 0x20)
+#define SPDR IO_REG8((0x0F) + 0x20)
+#define SPCR IO_REG8((0x0D) + 0x20)
+
+#define SPSR IO_REG8((0x0E) + 0x20)
+#define UDR IO_REG8((0x0C) + 0x20)
+#define UCSRA IO_REG8((0x0B) + 0x20)
+#define UCSRB IO_REG8((0x0A) + 0x20)
+#define UBRRL IO_REG8((0x09) + 0x20)
+#define ACSR IO_REG8((0x08) + 0x20)
+#define ADMUX IO_REG8((0x07) + 0x20)
+#define ADCSRA IO_REG8((0x06) + 0x20)
+
+#define ADC IO_REG16((0x04) + 0x20)
+#define ADCH IO_REG8((0x05) + 0x20)
+#define ADCL IO_REG8((0x04) + 0x20)
+
+#define TWDR IO_REG8((0x03) + 0x20)
+#define TWAR IO_REG8((0x02) + 0x20)
+#define TWSR IO_REG8((0x01) + 0x20)
+#define TWBR IO_REG8((0x00) + 0x20)
 /****************************************PINS***************************************/
 
+//SREG
+#define I_BIT 7
+
+/* Global interrupt enable/disable, the memory clobber keeps accesses inside the critical section */
+#if defined (HOST_BUILD)
+#define GLOBAL_INTERRUPT_ENABLE() (SREG |= (1 << I_BIT))
+#define GLOBAL_INTERRUPT_DISABLE() (SREG &= ~(1 << I_BIT))
+#else
+#define GLOBAL_INTERRUPT_ENABLE() __asm__ __volatile__ ("sei" ::: "memory")
+#define GLOBAL_INTERRUPT_DISABLE() __asm__ __volatile__ ("cli" ::: "memory")
+#endif
+
+//GICR
+#define INT2 5
+#define INT0 6
+#define INT1 7
+
+//GIFR
+#define INTF2 5
+#define INTF0 6
+#define INTF1 7
+
+//MCUCR
+#define ISC00 0
+#define ISC01 1
+#define ISC10 2
+#define ISC11 3
+
+//MCUCSR
+#define ISC2 6
+
 //UCSRA
 #define MPCM 0
 #define U2X 1
@@ -125,6 +173,21 @@
 #define UMSEL 6
 #define URSEL 7
 
+//SPCR
+#define SPR0 0
+#define SPR1 1
+#define CPHA 2
+#define CPOL 3
+#define MSTR 4
+#define DORD 5
+#define SPE 6
+#define SPIE 7
+
+//SPSR
+#define SPI2X 0
+#define WCOL 6
+#define SPIF 7
+
 
 //TWCR
 #define TWIE 0
@@ -135,4 +198,7 @@
 #define TWSTA 5
 #define TWEA 6
 #define TWINT 7
+
+//TWAR
+#define TWGCE 0
 #endif //ATMEGA32_ETAMINI_ATMEGA32_REGISTERS_H
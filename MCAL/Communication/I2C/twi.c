@@ -24,19 +24,250 @@
 
 #include "twi.h"
 #include "../../Atmega32_Registers.h"
+#include "../../gpio/gpio.h"
+#include "../../../delay.h"
+
+#if (TWI_QUEUE_SIZE < 2) || (TWI_QUEUE_SIZE > 128) \
+	|| ((TWI_QUEUE_SIZE & (TWI_QUEUE_SIZE - 1)) != 0)
+#error "TWI_QUEUE_SIZE must be a power of two from 2 to 128"
+#endif
+
+#define TWI_QUEUE_MASK (TWI_QUEUE_SIZE - 1)
+
+/*
+ * TWCR values written by the interrupt, TWINT = 1 starts the next operation. The
+ * master writes add twi_slave_twcr (TWEA) so an enabled slave still answers its
+ * address when the arbitration is lost, except TWI_receiveNext where TWEA is the
+ * ACK of the master receiver.
+ */
+#define TWI_TWCR_NEXT  ((1 << TWINT) | (1 << TWEN) | (1 << TWIE))
+#define TWI_TWCR_START (TWI_TWCR_NEXT | (1 << TWSTA))
+#define TWI_TWCR_STOP  ((1 << TWINT) | (1 << TWEN) | (1 << TWSTO))
+
+/* TWCR in the I/O space, for the in instruction of the wait loop */
+#define TWI_TWCR_IO_ADDRESS 0x36
+
+/* TWI interrupt */
+#define TWI_ISR __vector_19
+
+void TWI_ISR(void)__attribute__((signal, used, externally_visible));
+
+/* Transactions submitted, twi_queue[twi_queue_tail] is the one on the bus */
+static TWI_Transaction *twi_queue[TWI_QUEUE_SIZE];
+static volatile uint8 twi_queue_head = 0;
+static volatile uint8 twi_queue_tail = 0;
+static volatile boolean twi_busy = FALSE;
+/* Next byte to write or to read in the current transaction */
+static uint16 twi_index;
+/* The current transaction is in its read part */
+static boolean twi_reading;
+static uint8 twi_arbitration_retries;
+/* Ticks left before the transaction on the bus times out */
+static volatile uint8 twi_ticks_left;
+/* Set by TWI_tick on a timeout, the bus is recovered by TWI_processRecovery */
+static volatile boolean twi_recovery_pending = FALSE;
+
+/* Slave, twi_slave_twcr keeps TWEA and TWIE in the idle TWCR writes while enabled */
+static TWI_SlaveConfig twi_slave;
+static uint8 twi_slave_twcr = 0;
+static volatile boolean twi_slave_addressed = FALSE;
+static boolean twi_slave_pointer_next;
+static uint8 twi_slave_pointer = 0;
+static uint8 twi_slave_write_first;
+static uint8 twi_slave_write_count;
+static boolean twi_slave_general_call;
+
+/* Wait loops of the blocking functions before a timeout */
+static uint32 twi_timeout_loops;
+/* Status returned by TWI_getStatus instead of TWSR after a timeout or a bus error */
+static boolean twi_status_latched = FALSE;
+static uint8 twi_latched_status;
+
+/* Bit rate of TWI_init / TWI_setBitRate, used by the transactions without bit_rate */
+static TWI_BitRate twi_default_bit_rate;
+
+/*
+ * Description :
+ * Start a blocking operation, TWI_getStatus reads TWSR again.
+ */
+static void TWI_beginOperation(void) {
+	twi_status_latched = FALSE;
+}
+
+static void TWI_latchStatus(uint8 status) {
+	twi_latched_status = status;
+	twi_status_latched = TRUE;
+}
+
+/*
+ * Description :
+ * Poll TWCR until the bits of mask are equal to value, at most twi_timeout_loops
+ * times. Return FALSE on a timeout.
+ * On the AVR the loop is written in assembly, so one poll takes exactly
+ * TWI_POLL_LOOP_CYCLES cycles whatever the compiler and its options:
+ * in, and, cp, breq (not taken), 4 x subi/sbci (32-bit count) = 8 cycles and
+ * brne (taken) = 2 cycles. The host build advances the simulated time by the same.
+ */
+static boolean TWI_pollControl(uint8 mask, uint8 value) {
+	uint32 loops = twi_timeout_loops;
+#if defined (HOST_BUILD)
+	while ((TWCR & mask) != value) {
+		HOST_advanceCycles(TWI_POLL_LOOP_CYCLES - HOST_CYCLES_PER_ACCESS);
+		if (--loops == 0) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+#else
+	uint8 control;
+
+	__asm__ volatile (
+		"1: in %[control], %[twcr]" "\n\t" /* 1 cycle */
+		"and %[control], %[mask]" "\n\t"   /* 1 cycle */
+		"cp %[control], %[value]" "\n\t"   /* 1 cycle */
+		"breq 2f" "\n\t"                   /* 1 cycle while not equal */
+		"subi %A[loops], 1" "\n\t"         /* 4 cycles, loops - 1 */
+		"sbci %B[loops], 0" "\n\t"
+		"sbci %C[loops], 0" "\n\t"
+		"sbci %D[loops], 0" "\n\t"
+		"brne 1b" "\n\t"                   /* 2 cycles until loops is 0 */
+		"2:"
+		: [loops] "+d" (loops), [control] "=&r" (control)
+		: [twcr] "I" (TWI_TWCR_IO_ADDRESS), [mask] "r" (mask), [value] "r" (value)
+	);
+	return (loops != 0);
+#endif
+}
+
+/*
+ * Description :
+ * Wait for TWINT within the timeout. Return FALSE after a timeout (the bus is
+ * recovered) or a bus error (the lines are released).
+ */
+static boolean TWI_waitInterrupt(void) {
+	if (!TWI_pollControl((1 << TWINT), (1 << TWINT))) {
+		TWI_recoverBus();
+		TWI_latchStatus(TWI_TIMEOUT);
+		return FALSE;
+	}
+	if ((TWSR & 0xF8) == TWI_BUS_ERROR) {
+		/* TWSTO in the bus error state releases the lines, no STOP is sent */
+		TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+		TWI_latchStatus(TWI_BUS_ERROR);
+		return FALSE;
+	}
+	return TRUE;
+}
 
 void TWI_init(TWI_ConfigType *config) {
 
-	/* Bit Rate: 400.000 kbps using zero pre-scaler TWPS=00 and F_CPU=8Mhz */
+	/* Bit Rate: TWBR of the TWI_BaudRate solved for F_CPU, zero pre-scaler TWPS=00 */
 
 	TWBR = config->bit_rate;
 	TWSR = 0x00;
+	twi_default_bit_rate.twbr = config->bit_rate;
+	twi_default_bit_rate.twps = 0;
+	twi_default_bit_rate.achieved_scl = TWI_SCL_FOR(config->bit_rate, 0);
 
 	/* Two Wire Bus address my address if any master device want to call me: 0x1 (used in case this MC is a slave device)
 	 General Call Recognition: Off */
 	TWAR = config->address; // my address = 0x01 :)
 
 	TWCR = (1 << TWEN); /* enable TWI */
+
+	TWI_setTimeout(TWI_DEFAULT_TIMEOUT_US);
+	twi_status_latched = FALSE;
+}
+
+boolean TWI_solveBitRate(uint32 scl_frequency, TWI_BitRate *setting) {
+	uint32 twbr = 0;
+	uint8 twps;
+	boolean valid = TRUE;
+
+	if ((scl_frequency == 0) || (scl_frequency > F_CPU / 16)) {
+		/* Faster than TWBR = 0 allows, like TWI_SCL_VALID */
+		valid = FALSE;
+		twps = 0;
+	} else {
+		for (twps = 0; twps < 4; twps++) {
+			twbr = TWI_TWBR_FOR(scl_frequency, twps);
+			if (twbr <= 255) {
+				break;
+			}
+		}
+		if (twps == 4) {
+			/* Slower than TWBR = 255 with the largest prescaler */
+			valid = FALSE;
+			twps = 3;
+			twbr = 255;
+		}
+	}
+
+	setting->twbr = (uint8) twbr;
+	setting->twps = twps;
+	setting->achieved_scl = TWI_SCL_FOR(setting->twbr, twps);
+	return valid;
+}
+
+static void TWI_writeBitRate(const TWI_BitRate *setting) {
+	TWBR = setting->twbr;
+	/* Only TWPS1:0 are writable in TWSR */
+	TWSR = setting->twps & 0x03;
+}
+
+void TWI_setBitRate(const TWI_BitRate *setting) {
+	twi_default_bit_rate = *setting;
+	TWI_writeBitRate(setting);
+}
+
+uint32 TWI_getSclFrequency(void) {
+	return TWI_SCL_FOR(TWBR, TWSR & 0x03);
+}
+
+void TWI_setTimeout(uint16 microseconds) {
+	twi_timeout_loops = ((uint32) microseconds * (F_CPU / 1000000UL)) / TWI_POLL_LOOP_CYCLES;
+	if (twi_timeout_loops == 0) {
+		twi_timeout_loops = 1;
+	}
+}
+
+boolean TWI_recoverBus(void) {
+	uint8 i;
+	boolean released;
+
+	/* The pins are general I/O while TWEN is cleared */
+	TWCR = 0;
+	/*
+	 * Open drain: output low pulls the line down, input releases it. Port C may be
+	 * shared with ISRs, so only the atomic GPIO writes are used.
+	 */
+	GPIO_clearPinAtomic(TWI_SCL_PIN);
+	GPIO_clearPinAtomic(TWI_SDA_PIN);
+	GPIO_setupPinDirectionAtomic(TWI_SCL_PIN, PIN_INPUT);
+	GPIO_setupPinDirectionAtomic(TWI_SDA_PIN, PIN_INPUT);
+	delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+
+	/* Every pulse clocks out one bit of the byte the slave is sending */
+	for (i = 0; (i < 9) && (GPIO_readPin(TWI_SDA_PIN) == LOGIC_LOW); i++) {
+		GPIO_setupPinDirectionAtomic(TWI_SCL_PIN, PIN_OUTPUT);
+		delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+		GPIO_setupPinDirectionAtomic(TWI_SCL_PIN, PIN_INPUT);
+		delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+	}
+
+	/* STOP: SDA rises while SCL is high */
+	GPIO_setupPinDirectionAtomic(TWI_SCL_PIN, PIN_OUTPUT);
+	GPIO_setupPinDirectionAtomic(TWI_SDA_PIN, PIN_OUTPUT);
+	delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+	GPIO_setupPinDirectionAtomic(TWI_SCL_PIN, PIN_INPUT);
+	delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+	GPIO_setupPinDirectionAtomic(TWI_SDA_PIN, PIN_INPUT);
+	delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+
+	released = (GPIO_readPin(TWI_SCL_PIN) != LOGIC_LOW)
+			&& (GPIO_readPin(TWI_SDA_PIN) != LOGIC_LOW);
+	TWCR = (1 << TWEN) | twi_slave_twcr;
+	return released;
 }
 
 void TWI_start(void) {
@@ -45,11 +276,11 @@ void TWI_start(void) {
 	 * send the start bit by TWSTA=1
 	 * Enable TWI Module TWEN=1 
 	 */
+	TWI_beginOperation();
 	TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
 
 	/* Wait for TWINT flag set in TWCR Register (start bit is send successfully) */
-	while (BIT_IS_CLEAR(TWCR, TWINT))
-		;
+	TWI_waitInterrupt();
 }
 
 void TWI_stop(void) {
@@ -58,10 +289,18 @@ void TWI_stop(void) {
 	 * send the stop bit by TWSTO=1
 	 * Enable TWI Module TWEN=1 
 	 */
-	TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+	TWI_beginOperation();
+	TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN) | twi_slave_twcr;
+
+	/* TWSTO is cleared when the stop bit is sent */
+	if (!TWI_pollControl((1 << TWSTO), 0)) {
+		TWI_recoverBus();
+		TWI_latchStatus(TWI_TIMEOUT);
+	}
 }
 
 void TWI_writeByte(uint8 data) {
+	TWI_beginOperation();
 	/* Put data On TWI data Register */
 	TWDR = data;
 	/*
@@ -70,8 +309,7 @@ void TWI_writeByte(uint8 data) {
 	 */
 	TWCR = (1 << TWINT) | (1 << TWEN);
 	/* Wait for TWINT flag set in TWCR Register(data is send successfully) */
-	while (BIT_IS_CLEAR(TWCR, TWINT))
-		;
+	TWI_waitInterrupt();
 }
 
 uint8 TWI_readByteWithACK(void) {
@@ -80,10 +318,10 @@ uint8 TWI_readByteWithACK(void) {
 	 * Enable sending ACK after reading or receiving data TWEA=1
 	 * Enable TWI Module TWEN=1 
 	 */
+	TWI_beginOperation();
 	TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWEA);
 	/* Wait for TWINT flag set in TWCR Register (data received successfully) */
-	while (BIT_IS_CLEAR(TWCR, TWINT))
-		;
+	TWI_waitInterrupt();
 	/* Read Data */
 	return TWDR;
 }
@@ -93,17 +331,481 @@ uint8 TWI_readByteWithNACK(void) {
 	 * Clear the TWINT flag before reading the data TWINT=1
 	 * Enable TWI Module TWEN=1 
 	 */
+	TWI_beginOperation();
 	TWCR = (1 << TWINT) | (1 << TWEN);
 	/* Wait for TWINT flag set in TWCR Register (data received successfully) */
-	while (BIT_IS_CLEAR(TWCR, TWINT))
-		;
+	TWI_waitInterrupt();
 	/* Read Data */
 	return TWDR;
 }
 
 uint8 TWI_getStatus(void) {
 	uint8 status;
+
+	if (twi_status_latched) {
+		return twi_latched_status;
+	}
 	/* masking to eliminate first 3 bits and get the last 5 bits (status bits) */
 	status = TWSR & 0xF8;
 	return status;
 }
+
+/*
+ * Description :
+ * Result of the last blocking step, OK if the status is the expected one.
+ */
+static TWI_Result TWI_checkStatus(uint8 expected) {
+	uint8 status = TWI_getStatus();
+
+	if (status == expected) {
+		return TWI_RESULT_OK;
+	}
+	switch (status) {
+	case TWI_TIMEOUT:
+		return TWI_RESULT_TIMEOUT;
+	case TWI_ARB_LOST:
+		return TWI_RESULT_ARBITRATION_LOST;
+	case TWI_MT_SLA_W_NACK:
+	case TWI_MT_SLA_R_NACK:
+		return TWI_RESULT_ADDRESS_NACK;
+	case TWI_MT_DATA_NACK:
+		return TWI_RESULT_DATA_NACK;
+	default:
+		return TWI_RESULT_BUS_ERROR;
+	}
+}
+
+static TWI_Result TWI_writeBytes(const uint8 *data, uint16 length) {
+	TWI_Result result = TWI_RESULT_OK;
+
+	while ((length != 0) && (result == TWI_RESULT_OK)) {
+		TWI_writeByte(*data);
+		result = TWI_checkStatus(TWI_MT_DATA_ACK);
+		data++;
+		length--;
+	}
+	return result;
+}
+
+/*
+ * Description :
+ * TRUE while this slave is addressed or its TWINT waits for the ISR (interrupts
+ * disabled): a TWCR write with TWINT = 1 would drop that event and clear TWEA.
+ */
+static boolean TWI_slaveFrameActive(void) {
+	return twi_slave_addressed || ((twi_slave_twcr != 0) && BIT_IS_SET(TWCR, TWINT));
+}
+
+/*
+ * Description :
+ * TWI_transfer with prefix_length bytes (a register address) written before write_data.
+ */
+static TWI_Result TWI_transferPrefixed(uint8 address, const uint8 *prefix,
+		uint8 prefix_length, const uint8 *write_data, uint16 write_length,
+		uint8 *read_data, uint16 read_length) {
+	TWI_Result result = TWI_RESULT_OK;
+	uint8 start = TWI_START;
+
+	/* Leave the frame of the external master alone, the caller tries again later */
+	if (TWI_slaveFrameActive()) {
+		return TWI_RESULT_BUS_ERROR;
+	}
+
+	if ((prefix_length != 0) || (write_length != 0) || (read_length == 0)) {
+		TWI_start();
+		result = TWI_checkStatus(TWI_START);
+		if (result == TWI_RESULT_OK) {
+			TWI_writeByte((uint8) (address << 1));
+			result = TWI_checkStatus(TWI_MT_SLA_W_ACK);
+		}
+		if (result == TWI_RESULT_OK) {
+			result = TWI_writeBytes(prefix, prefix_length);
+		}
+		if (result == TWI_RESULT_OK) {
+			result = TWI_writeBytes(write_data, write_length);
+		}
+		start = TWI_REP_START;
+	}
+
+	if ((read_length != 0) && (result == TWI_RESULT_OK)) {
+		TWI_start();
+		result = TWI_checkStatus(start);
+		if (result == TWI_RESULT_OK) {
+			TWI_writeByte((uint8) ((address << 1) | 1));
+			result = TWI_checkStatus(TWI_MT_SLA_R_ACK);
+		}
+		while ((read_length > 1) && (result == TWI_RESULT_OK)) {
+			*read_data = TWI_readByteWithACK();
+			result = TWI_checkStatus(TWI_MR_DATA_ACK);
+			read_data++;
+			read_length--;
+		}
+		if (result == TWI_RESULT_OK) {
+			*read_data = TWI_readByteWithNACK();
+			result = TWI_checkStatus(TWI_MR_DATA_NACK);
+		}
+	}
+
+	/* After a timeout the bus is already recovered */
+	if (result != TWI_RESULT_TIMEOUT) {
+		TWI_stop();
+		if (TWI_getStatus() == TWI_TIMEOUT) {
+			result = TWI_RESULT_TIMEOUT;
+		}
+	}
+	return result;
+}
+
+TWI_Result TWI_transfer(uint8 address, const uint8 *write_data, uint16 write_length,
+		uint8 *read_data, uint16 read_length) {
+	return TWI_transferPrefixed(address, NULL_PTR, 0, write_data, write_length,
+			read_data, read_length);
+}
+
+TWI_Result TWI_writeRegs(uint8 address, uint8 reg, const uint8 *data, uint16 length) {
+	return TWI_transferPrefixed(address, &reg, 1, data, length, NULL_PTR, 0);
+}
+
+TWI_Result TWI_readRegs(uint8 address, uint8 reg, uint8 *data, uint16 length) {
+	return TWI_transferPrefixed(address, &reg, 1, NULL_PTR, 0, data, length);
+}
+
+/*
+ * Use the bit rate of transaction, or the default one so a slow device does not
+ * slow down the next transactions. The bus is idle or only the STOP is left.
+ */
+static void TWI_applyBitRate(const TWI_Transaction *transaction) {
+	TWI_writeBitRate((transaction->bit_rate != NULL_PTR) ?
+			transaction->bit_rate : &twi_default_bit_rate);
+}
+
+boolean TWI_submit(TWI_Transaction *transaction) {
+	uint8 head;
+	uint8 sreg;
+
+	sreg = SREG;
+	GLOBAL_INTERRUPT_DISABLE();
+	head = twi_queue_head;
+	if ((uint8) (head - twi_queue_tail) >= TWI_QUEUE_SIZE) {
+		SREG = sreg;
+		return FALSE;
+	}
+	transaction->result = TWI_RESULT_PENDING;
+	twi_queue[head & TWI_QUEUE_MASK] = transaction;
+	twi_queue_head = head + 1;
+	if (!twi_busy) {
+		twi_busy = TRUE;
+		twi_index = 0;
+		twi_reading = FALSE;
+		twi_arbitration_retries = 0;
+		twi_ticks_left = TWI_TIMEOUT_TICKS;
+		TWI_applyBitRate(transaction);
+		/*
+		 * While the slave is addressed, or its TWINT waits for the ISR, writing
+		 * TWINT would drop its event and clear TWEA in the middle of the frame.
+		 * TWI_slaveEnd sends the START at the end of the frame instead.
+		 */
+		if (!TWI_slaveFrameActive()) {
+			TWCR = TWI_TWCR_START | twi_slave_twcr;
+		}
+	}
+	SREG = sreg;
+	return TRUE;
+}
+
+uint8 TWI_getPendingTransactions(void) {
+	return (uint8) (twi_queue_head - twi_queue_tail);
+}
+
+boolean TWI_isBusy(void) {
+	return twi_busy;
+}
+
+/*
+ * Description :
+ * Send the STOP of the current transaction and start the next one, the STOP and the
+ * next START are sent by the same TWCR write.
+ */
+static void TWI_finish(TWI_Result result) {
+	uint8 tail = twi_queue_tail;
+	TWI_Transaction *transaction = twi_queue[tail & TWI_QUEUE_MASK];
+
+	tail++;
+	twi_queue_tail = tail;
+	twi_index = 0;
+	twi_reading = FALSE;
+	twi_arbitration_retries = 0;
+	twi_ticks_left = TWI_TIMEOUT_TICKS;
+	if (tail != twi_queue_head) {
+		TWI_applyBitRate(twi_queue[tail & TWI_QUEUE_MASK]);
+		TWCR = TWI_TWCR_START | (1 << TWSTO) | twi_slave_twcr;
+	} else {
+		/* Leave the default rate to the blocking functions */
+		if (transaction->bit_rate != NULL_PTR) {
+			TWI_writeBitRate(&twi_default_bit_rate);
+		}
+		TWCR = TWI_TWCR_STOP | twi_slave_twcr;
+		twi_busy = FALSE;
+	}
+
+	transaction->result = result;
+	/* Called last, the callback may submit the next transaction */
+	if (transaction->callback != NULL_PTR) {
+		transaction->callback(transaction);
+	}
+}
+
+/* Clear TWINT to receive the next byte, ACK it unless it is the last one */
+static void TWI_receiveNext(const TWI_Transaction *transaction) {
+	if (twi_index + 1 < transaction->read_length) {
+		TWCR = TWI_TWCR_NEXT | (1 << TWEA);
+	} else {
+		TWCR = TWI_TWCR_NEXT;
+	}
+}
+
+static uint8 TWI_slaveReadRegister(void) {
+	uint8 data = 0xFF;
+
+	if (twi_slave_pointer < twi_slave.size) {
+		data = twi_slave.registers[twi_slave_pointer];
+	}
+	if (twi_slave_pointer != 0xFF) {
+		twi_slave_pointer++;
+	}
+	return data;
+}
+
+static void TWI_slaveWriteRegister(uint8 data) {
+	if (twi_slave_pointer_next) {
+		/* The first byte of a write frame is the register pointer */
+		twi_slave_pointer_next = FALSE;
+		twi_slave_pointer = data;
+		twi_slave_write_first = data;
+		return;
+	}
+	if (twi_slave_pointer < twi_slave.writable_size) {
+		twi_slave.registers[twi_slave_pointer] = data;
+		twi_slave_write_count++;
+	}
+	if (twi_slave_pointer != 0xFF) {
+		twi_slave_pointer++;
+	}
+}
+
+/*
+ * Description :
+ * End of a slave frame, keep answering the slave address. A submitted transaction
+ * waiting for the bus or interrupted by this frame is sent again from its start.
+ */
+static void TWI_slaveEnd(void) {
+	twi_slave_addressed = FALSE;
+	if (twi_busy) {
+		twi_index = 0;
+		twi_reading = FALSE;
+		TWCR = TWI_TWCR_START | twi_slave_twcr;
+	} else {
+		TWCR = TWI_TWCR_NEXT | twi_slave_twcr;
+	}
+}
+
+/*
+ * Description :
+ * TWI slave state machine, the SR and ST status codes.
+ */
+static void TWI_slaveEvent(uint8 status) {
+	switch (status) {
+	case TWI_SR_SLA_ACK:
+	case TWI_SR_ARB_LOST_SLA_ACK:
+	case TWI_SR_GCALL_ACK:
+	case TWI_SR_ARB_LOST_GCALL_ACK:
+		twi_slave_addressed = TRUE;
+		twi_slave_pointer_next = TRUE;
+		twi_slave_write_count = 0;
+		twi_slave_general_call = (status == TWI_SR_GCALL_ACK)
+				|| (status == TWI_SR_ARB_LOST_GCALL_ACK);
+		TWCR = TWI_TWCR_NEXT | twi_slave_twcr;
+		break;
+	case TWI_SR_DATA_ACK:
+	case TWI_SR_GCALL_DATA_ACK:
+		TWI_slaveWriteRegister(TWDR);
+		TWCR = TWI_TWCR_NEXT | twi_slave_twcr;
+		break;
+	case TWI_SR_STOP:
+		if ((twi_slave_write_count != 0) && (twi_slave.write_callback != NULL_PTR)) {
+			twi_slave.write_callback(twi_slave_write_first, twi_slave_write_count,
+					twi_slave_general_call);
+		}
+		TWI_slaveEnd();
+		break;
+	case TWI_ST_SLA_ACK:
+	case TWI_ST_ARB_LOST_SLA_ACK:
+		twi_slave_addressed = TRUE;
+		TWDR = TWI_slaveReadRegister();
+		TWCR = TWI_TWCR_NEXT | twi_slave_twcr;
+		break;
+	case TWI_ST_DATA_ACK:
+		TWDR = TWI_slaveReadRegister();
+		TWCR = TWI_TWCR_NEXT | twi_slave_twcr;
+		break;
+	case TWI_SR_DATA_NACK:
+	case TWI_SR_GCALL_DATA_NACK:
+	case TWI_ST_DATA_NACK:
+	case TWI_ST_LAST_DATA:
+	default:
+		/* Not addressed any more, the master ends the frame */
+		TWI_slaveEnd();
+		break;
+	}
+}
+
+void TWI_initSlave(const TWI_SlaveConfig *config) {
+	uint8 sreg = SREG;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	twi_slave = *config;
+	twi_slave_pointer = 0;
+	twi_slave_addressed = FALSE;
+	TWAR = (uint8) ((config->address << 1) | (config->general_call ? (1 << TWGCE) : 0));
+	twi_slave_twcr = (1 << TWEA) | (1 << TWIE);
+	if (!twi_busy) {
+		TWCR = (1 << TWEN) | twi_slave_twcr;
+	}
+	SREG = sreg;
+}
+
+void TWI_disableSlave(void) {
+	uint8 sreg = SREG;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	twi_slave_twcr = 0;
+	twi_slave_addressed = FALSE;
+	if (!twi_busy) {
+		TWCR = (1 << TWEN);
+	}
+	SREG = sreg;
+}
+
+boolean TWI_slaveIsAddressed(void) {
+	return twi_slave_addressed;
+}
+
+/*
+ * Description :
+ * TWI master state machine, every TWINT of the current transaction.
+ */
+void TWI_ISR(void) {
+	TWI_Transaction *transaction = twi_queue[twi_queue_tail & TWI_QUEUE_MASK];
+
+	uint8 status = TWSR & 0xF8;
+
+	/* Every step is progress, the timeout counts from here */
+	twi_ticks_left = TWI_TIMEOUT_TICKS;
+	if ((status >= TWI_SR_SLA_ACK) && (status <= TWI_ST_LAST_DATA)) {
+		TWI_slaveEvent(status);
+		return;
+	}
+	if (!twi_busy) {
+		/* Bus error while only the slave is enabled, release the lines */
+		twi_slave_addressed = FALSE;
+		TWCR = TWI_TWCR_STOP | twi_slave_twcr;
+		return;
+	}
+	switch (status) {
+	case TWI_START:
+	case TWI_REP_START:
+		if (!twi_reading && (transaction->write_length == 0)
+				&& (transaction->read_length != 0)) {
+			twi_reading = TRUE;
+		}
+		TWDR = (uint8) ((transaction->address << 1) | twi_reading);
+		TWCR = TWI_TWCR_NEXT | twi_slave_twcr;
+		break;
+	case TWI_MT_SLA_W_ACK:
+	case TWI_MT_DATA_ACK:
+		if (twi_index < transaction->write_length) {
+			TWDR = transaction->write_data[twi_index];
+			twi_index++;
+			TWCR = TWI_TWCR_NEXT | twi_slave_twcr;
+		} else if (transaction->read_length != 0) {
+			twi_index = 0;
+			twi_reading = TRUE;
+			if (transaction->repeated_start) {
+				TWCR = TWI_TWCR_START | twi_slave_twcr;
+			} else {
+				TWCR = TWI_TWCR_START | (1 << TWSTO) | twi_slave_twcr;
+			}
+		} else {
+			TWI_finish(TWI_RESULT_OK);
+		}
+		break;
+	case TWI_MT_SLA_R_ACK:
+		TWI_receiveNext(transaction);
+		break;
+	case TWI_MR_DATA_ACK:
+		transaction->read_data[twi_index] = TWDR;
+		twi_index++;
+		TWI_receiveNext(transaction);
+		break;
+	case TWI_MR_DATA_NACK:
+		transaction->read_data[twi_index] = TWDR;
+		TWI_finish(TWI_RESULT_OK);
+		break;
+	case TWI_MT_SLA_W_NACK:
+	case TWI_MT_SLA_R_NACK:
+		TWI_finish(TWI_RESULT_ADDRESS_NACK);
+		break;
+	case TWI_MT_DATA_NACK:
+		TWI_finish(TWI_RESULT_DATA_NACK);
+		break;
+	case TWI_ARB_LOST:
+		if (twi_arbitration_retries < TWI_MAX_ARBITRATION_RETRIES) {
+			/* Another master won the bus, send the transaction again when it is free */
+			twi_arbitration_retries++;
+			twi_index = 0;
+			twi_reading = FALSE;
+			TWCR = TWI_TWCR_START | twi_slave_twcr;
+		} else {
+			TWI_finish(TWI_RESULT_ARBITRATION_LOST);
+		}
+		break;
+	case TWI_BUS_ERROR:
+	default:
+		/* TWSTO in the bus error state only releases the lines, nothing is sent */
+		TWI_finish(TWI_RESULT_BUS_ERROR);
+		break;
+	}
+}
+
+void TWI_tick(void) {
+	uint8 sreg = SREG;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	if (twi_busy && !twi_recovery_pending && (--twi_ticks_left == 0)) {
+		/*
+		 * Stop the TWI (TWCR = 0 also clears TWIE) and leave the slow bit-banged
+		 * recovery to TWI_processRecovery in the main loop
+		 */
+		TWCR = 0;
+		twi_recovery_pending = TRUE;
+	}
+	SREG = sreg;
+}
+
+boolean TWI_processRecovery(void) {
+	uint8 sreg;
+
+	if (!twi_recovery_pending) {
+		return FALSE;
+	}
+	/* With the interrupts enabled, the TWI is stopped so its ISR can not run */
+	TWI_recoverBus();
+
+	sreg = SREG;
+	GLOBAL_INTERRUPT_DISABLE();
+	twi_recovery_pending = FALSE;
+	/* TWI_finish starts the next transaction */
+	TWI_finish(TWI_RESULT_TIMEOUT);
+	SREG = sreg;
+	return TRUE;
+}
@@ -31,15 +31,202 @@
 #define TWI_MT_DATA_ACK   0x28 /* Master transmit data and ACK has been received from Slave. */
 #define TWI_MR_DATA_ACK   0x50 /* Master received data and send ACK to slave. */
 #define TWI_MR_DATA_NACK  0x58 /* Master received data but doesn't send ACK to slave. */
+#define TWI_MT_SLA_W_NACK 0x20 /* Master transmit ( slave address + Write request ) to slave + NACK received from slave. */
+#define TWI_MT_DATA_NACK  0x30 /* Master transmit data and NACK has been received from Slave. */
+#define TWI_ARB_LOST      0x38 /* Arbitration lost in SLA+R/W or data, the bus is released. */
+#define TWI_MT_SLA_R_NACK 0x48 /* Master transmit ( slave address + Read request ) to slave + NACK received from slave. */
+#define TWI_NO_INFO       0xF8 /* No relevant state information, TWINT is cleared. */
+#define TWI_BUS_ERROR     0x00 /* Illegal START or STOP condition on the bus. */
+#define TWI_TIMEOUT       0x01 /* Driver status, not in TWSR: no TWINT within the timeout, the bus was recovered. */
 
+/* I2C Status Bits of the slave receiver (SR) and slave transmitter (ST) modes */
+#define TWI_SR_SLA_ACK             0x60 /* Own SLA+W received, ACK returned. */
+#define TWI_SR_ARB_LOST_SLA_ACK    0x68 /* Arbitration lost as master, own SLA+W received, ACK returned. */
+#define TWI_SR_GCALL_ACK           0x70 /* General call address received, ACK returned. */
+#define TWI_SR_ARB_LOST_GCALL_ACK  0x78 /* Arbitration lost as master, general call received, ACK returned. */
+#define TWI_SR_DATA_ACK            0x80 /* Addressed with own SLA+W, data received, ACK returned. */
+#define TWI_SR_DATA_NACK           0x88 /* Addressed with own SLA+W, data received, NACK returned. */
+#define TWI_SR_GCALL_DATA_ACK      0x90 /* Addressed with general call, data received, ACK returned. */
+#define TWI_SR_GCALL_DATA_NACK     0x98 /* Addressed with general call, data received, NACK returned. */
+#define TWI_SR_STOP                0xA0 /* STOP or repeated START received while addressed. */
+#define TWI_ST_SLA_ACK             0xA8 /* Own SLA+R received, ACK returned. */
+#define TWI_ST_ARB_LOST_SLA_ACK    0xB0 /* Arbitration lost as master, own SLA+R received, ACK returned. */
+#define TWI_ST_DATA_ACK            0xB8 /* Data transmitted, ACK received. */
+#define TWI_ST_DATA_NACK           0xC0 /* Data transmitted, NACK received (end of the read). */
+#define TWI_ST_LAST_DATA           0xC8 /* Last data byte transmitted (TWEA = 0), ACK received. */
+
+/* General call address, answered by the slave when general_call is TRUE */
+#define TWI_GENERAL_CALL_ADDRESS 0x00
+
+/*
+ * Bounded time
+ * Every wait of the blocking functions gives up after the timeout (TWI_setTimeout,
+ * TWI_DEFAULT_TIMEOUT_US after TWI_init), recovers the bus with TWI_recoverBus and
+ * makes TWI_getStatus return TWI_TIMEOUT until the next operation. A bus error is
+ * cleared the same way and TWI_getStatus returns TWI_BUS_ERROR. The worst case of a
+ * blocking function is the timeout plus the recovery (about 100 us), plus the
+ * time taken by the ISRs that interrupt the wait.
+ * TWI_POLL_LOOP_CYCLES is the length of one wait loop used to count the timeout.
+ * The loop is written in assembly so the count is exact (see TWI_pollControl in
+ * twi.c), it must not be changed without changing the loop.
+ *
+ * The submitted transactions are bounded by TWI_tick, called every tick (e.g. 1 ms)
+ * from a timer callback: a transaction without progress for TWI_TIMEOUT_TICKS ticks
+ * stops the TWI and flags a recovery. TWI_processRecovery, called from the main
+ * loop, then recovers the bus outside of the interrupts and ends the transaction
+ * with TWI_RESULT_TIMEOUT. An arbitration lost is retried
+ * TWI_MAX_ARBITRATION_RETRIES times.
+ */
+#define TWI_DEFAULT_TIMEOUT_US      1000
+#define TWI_POLL_LOOP_CYCLES        10
+#define TWI_TIMEOUT_TICKS           5
+#define TWI_MAX_ARBITRATION_RETRIES 3
+
+/* TWI pins of the ATmega32, driven by TWI_recoverBus */
+#define TWI_SCL_PIN C0
+#define TWI_SDA_PIN C1
+
+/* Half SCL period of the recovery pulses, 100 kHz */
+#define TWI_RECOVERY_HALF_PERIOD_US 5
+
+/*
+ * Number of TWI_submit transactions that can wait, power of two from 2 to 128.
+ */
+#define TWI_QUEUE_SIZE 4
+
+/*
+ * Bit rate solver, the same formulas are used at compile time (constant SCL) and at
+ * run time by TWI_solveBitRate:
+ * SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS)
+ * The cycles per SCL period are rounded up, so the achieved rate is never above the
+ * requested one, and the smallest prescaler TWPS that fits TWBR in 8 bits is used.
+ * The data sheet asks for TWBR >= 10 in master mode, it is not enforced so 400 kHz
+ * stays available at 8 MHz (TWBR = 2).
+ */
+#define TWI_PRESCALER(TWPS) (1UL << (2 * (TWPS)))
+
+#define TWI_PERIOD_FOR(SCL) (((F_CPU) + (SCL) - 1) / (SCL))
+
+#define TWI_TWBR_FOR(SCL, TWPS) \
+	((TWI_PERIOD_FOR(SCL) <= 16) ? 0 : \
+		((TWI_PERIOD_FOR(SCL) - 16 + 2 * TWI_PRESCALER(TWPS) - 1) / (2 * TWI_PRESCALER(TWPS))))
+
+#define TWI_TWPS(SCL) \
+	((TWI_TWBR_FOR(SCL, 0) <= 255) ? 0 : (TWI_TWBR_FOR(SCL, 1) <= 255) ? 1 : \
+		(TWI_TWBR_FOR(SCL, 2) <= 255) ? 2 : 3)
+
+#define TWI_TWBR(SCL) TWI_TWBR_FOR(SCL, TWI_TWPS(SCL))
+
+/* SCL of a register setting */
+#define TWI_SCL_FOR(TWBR, TWPS) ((F_CPU) / (16 + 2UL * (TWBR) * TWI_PRESCALER(TWPS)))
+
+#define TWI_ACHIEVED_SCL(SCL) TWI_SCL_FOR(TWI_TWBR(SCL), TWI_TWPS(SCL))
+
+/* Above F_CPU / 16 or below the TWBR = 255, TWPS = 3 rate there is no setting */
+#define TWI_SCL_VALID(SCL) \
+	(((SCL) <= (F_CPU) / 16) && (TWI_TWBR_FOR(SCL, 3) <= 255))
+
+/*
+ * Define a constant TWI_BitRate solved at compile time, the build fails when the
+ * rate can not be reached:
+ *     TWI_DEFINE_BIT_RATE(eeprom_rate, 400000UL);
+ */
+#define TWI_DEFINE_BIT_RATE(NAME, SCL) \
+	_Static_assert(TWI_SCL_VALID(SCL), "TWI SCL frequency out of range for this F_CPU"); \
+	static const TWI_BitRate NAME = { TWI_TWBR(SCL), TWI_TWPS(SCL), TWI_ACHIEVED_SCL(SCL) }
+
+/*
+ * TWBR values for TWI_init, it sets the prescaler to 1 (TWPS = 0).
+ */
 typedef enum {
-	SCL_400kbit = 2,
+	SCL_400kbit = TWI_TWBR_FOR(400000UL, 0),
+	SCL_100kbit = TWI_TWBR_FOR(100000UL, 0),
 } TWI_BaudRate;
 typedef struct {
 	uint8 address;
 	TWI_BaudRate bit_rate;
 } TWI_ConfigType;
 
+/*
+ * Bit rate register setting found by TWI_solveBitRate or TWI_DEFINE_BIT_RATE:
+ * twbr         : TWBR value
+ * twps         : prescaler bits of TWSR, the prescaler is 4^twps
+ * achieved_scl : real SCL frequency in Hz, not above the requested one
+ */
+typedef struct {
+	uint8 twbr;
+	uint8 twps;
+	uint32 achieved_scl;
+} TWI_BitRate;
+
+/*
+ * Result of a TWI_submit transaction, given to its callback.
+ */
+typedef enum {
+	TWI_RESULT_OK,
+	TWI_RESULT_PENDING, /* queued or on the bus */
+	TWI_RESULT_ADDRESS_NACK, /* no slave answered SLA+R/W */
+	TWI_RESULT_DATA_NACK, /* the slave did not ACK a written byte */
+	TWI_RESULT_BUS_ERROR, /* illegal START/STOP, unexpected status or slave frame active */
+	TWI_RESULT_ARBITRATION_LOST, /* lost TWI_MAX_ARBITRATION_RETRIES + 1 times */
+	TWI_RESULT_TIMEOUT, /* no progress for TWI_TIMEOUT_TICKS, the bus was recovered */
+} TWI_Result;
+
+typedef struct TWI_Transaction TWI_Transaction;
+
+/*
+ * Called from the TWI interrupt when the transaction is done, the transaction and
+ * its buffers belong to the caller again.
+ */
+typedef void (*TwiTransactionCallback)(TWI_Transaction *transaction);
+
+/*
+ * A master transaction with the slave of the 7-bit address: write_length bytes of
+ * write_data then read_length bytes to read_data. The read follows the write after a
+ * repeated START when repeated_start is TRUE, after a STOP and a START otherwise.
+ * With both lengths 0 only SLA+W is sent (address probe). callback may be NULL_PTR.
+ * bit_rate lets a slow device have its own SCL without slowing down the others: the
+ * transactions without one run at the default rate of TWI_init / TWI_setBitRate.
+ */
+struct TWI_Transaction {
+	uint8 address;
+	const uint8 *write_data;
+	uint16 write_length;
+	uint8 *read_data;
+	uint16 read_length;
+	boolean repeated_start;
+	TwiTransactionCallback callback;
+	const TWI_BitRate *bit_rate; /* applied before the START, NULL_PTR for the default one */
+	volatile TWI_Result result;
+};
+
+/*
+ * Called from the TWI interrupt at the end of a write frame of the master that
+ * changed count registers from first, general_call when it came by the general call.
+ */
+typedef void (*TwiSlaveWriteCallback)(uint8 first, uint8 count, boolean general_call);
+
+/*
+ * Register-map slave, like the common I2C peripherals:
+ * address        : own 7-bit address
+ * general_call   : also accept writes to the general call address 0
+ * registers      : register array used in place (zero-copy), size registers
+ * writable_size  : the registers below it can be written by the master, the others
+ *                  are read only (e.g. a telemetry block)
+ * write_callback : may be NULL_PTR
+ * A write frame starts with the register pointer, the next bytes are written from it.
+ * A read frame sends the registers from the pointer, 0xFF after the last one. The
+ * pointer is incremented after every byte and kept between frames.
+ */
+typedef struct {
+	uint8 address;
+	boolean general_call;
+	uint8 *registers;
+	uint8 size;
+	uint8 writable_size;
+	TwiSlaveWriteCallback write_callback;
+} TWI_SlaveConfig;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
@@ -51,4 +238,137 @@ uint8 TWI_readByteWithACK(void);
 uint8 TWI_readByteWithNACK(void);
 uint8 TWI_getStatus(void);
 
+/*
+ * Description :
+ * Blocking combined transaction with the slave of the 7-bit address: START, SLA+W and
+ * write_length bytes of write_data, then a repeated START, SLA+R and read_length
+ * bytes to read_data (ACK on all of them but the last), then STOP. A part with a
+ * length of 0 is skipped, with both lengths 0 only SLA+W is sent (address probe).
+ * Every step is checked and bounded by the timeout of TWI_setTimeout. Not to be
+ * used while TWI_isBusy returns TRUE.
+ * With TWI_initSlave, the blocking functions must not run against an active slave
+ * frame: while TWI_slaveIsAddressed returns TRUE, or a slave event waits with the
+ * interrupts disabled, TWI_transfer, TWI_writeRegs and TWI_readRegs (so the EEPROM
+ * driver too) return TWI_RESULT_BUS_ERROR without touching the bus. TWI_start,
+ * TWI_stop, TWI_writeByte and TWI_readByteWith(N)ACK do not check it, call them only
+ * while TWI_slaveIsAddressed returns FALSE with the interrupts enabled. A blocking
+ * transfer runs with TWIE and TWEA cleared, so this slave is not answered during it.
+ */
+TWI_Result TWI_transfer(uint8 address, const uint8 *write_data, uint16 write_length,
+		uint8 *read_data, uint16 read_length);
+
+/*
+ * Description :
+ * Write length bytes of data to the registers of the slave from reg (the slave
+ * increments its register pointer), in one TWI_transfer without copying the data.
+ */
+TWI_Result TWI_writeRegs(uint8 address, uint8 reg, const uint8 *data, uint16 length);
+
+/*
+ * Description :
+ * Burst read of length registers of the slave from reg: reg is written, then the
+ * registers are read after a repeated START.
+ */
+TWI_Result TWI_readRegs(uint8 address, uint8 reg, uint8 *data, uint16 length);
+
+/*
+ * Description :
+ * Find TWBR and the smallest prescaler for scl_frequency (Hz) at F_CPU, the achieved
+ * SCL is not above the requested one. Return FALSE if no setting reaches it, the
+ * setting is then the nearest limit.
+ */
+boolean TWI_solveBitRate(uint32 scl_frequency, TWI_BitRate *setting);
+
+/*
+ * Description :
+ * Write TWBR and the prescaler bits, between two transfers only. The setting is also
+ * the default rate, used by the blocking functions and the transactions without
+ * bit_rate (TWI_init sets it first).
+ */
+void TWI_setBitRate(const TWI_BitRate *setting);
+
+/*
+ * Description :
+ * Return the SCL frequency of the current TWBR and prescaler.
+ */
+uint32 TWI_getSclFrequency(void);
+
+/*
+ * Description :
+ * Set the timeout of every wait of the blocking functions.
+ */
+void TWI_setTimeout(uint16 microseconds);
+
+/*
+ * Description :
+ * Free a bus held by a slave: disable the TWI, clock SCL up to 9 times through the
+ * GPIO until the slave releases SDA, send a STOP and enable the TWI again. SCL and
+ * SDA need their external pull-ups, the internal ones are turned off. Return TRUE if
+ * both lines are high at the end. Not to be called while TWI_isBusy returns TRUE.
+ */
+boolean TWI_recoverBus(void);
+
+/*
+ * Description :
+ * Count the timeout of the submitted transaction on the bus, call it periodically
+ * (ISR safe). On a timeout the TWI is stopped and a recovery is flagged.
+ */
+void TWI_tick(void);
+
+/*
+ * Description :
+ * Call from the main loop: recover the bus flagged by TWI_tick, end the stuck
+ * transaction with TWI_RESULT_TIMEOUT (its callback is called from here) and start
+ * the next one. Return TRUE if a recovery was done.
+ */
+boolean TWI_processRecovery(void);
+
+/*
+ * Description :
+ * Answer the master as the register-map slave of config from the TWI interrupt,
+ * TWI_init must be called first. The submitted master transactions still work, one
+ * interrupted by the master addressing this slave is sent again after it, and one
+ * submitted while this slave is addressed starts at the end of the frame. The global
+ * interrupts must be enabled.
+ * A value of more than one byte must be written to the registers with the interrupts
+ * disabled, and while TWI_slaveIsAddressed returns FALSE so a burst read does not
+ * mix the old and the new bytes.
+ */
+void TWI_initSlave(const TWI_SlaveConfig *config);
+
+/*
+ * Description :
+ * Stop answering the slave address and the general call.
+ */
+void TWI_disableSlave(void);
+
+/*
+ * Description :
+ * Return TRUE between the SLA+R/W that addressed this slave and the end of the frame.
+ */
+boolean TWI_slaveIsAddressed(void);
+
+/*
+ * Description :
+ * Queue a transaction for the TWI interrupt (TWIE), it starts at once if the queue is
+ * empty. The main loop runs while the interrupt moves the bytes. TWI_init must be
+ * called first and the global interrupts enabled. The transaction is used in place
+ * and must stay unchanged until its callback, its result is TWI_RESULT_PENDING until
+ * then. Return FALSE if TWI_QUEUE_SIZE transactions are already waiting.
+ * The blocking functions must not be used while TWI_isBusy returns TRUE.
+ */
+boolean TWI_submit(TWI_Transaction *transaction);
+
+/*
+ * Description :
+ * Return the number of submitted transactions not done yet.
+ */
+uint8 TWI_getPendingTransactions(void);
+
+/*
+ * Description :
+ * Return TRUE while the interrupt owns the bus.
+ */
+boolean TWI_isBusy(void);
+
 #endif /* TWI_H_ */
@@ -16,16 +16,111 @@
 
 #include "spi.h"
 #include "../../Atmega32_Registers.h"
-#include "..\..\..\common_macros.h" /* To use the macros like SET_BIT */
+#include "../../../common_macros.h" /* To use the macros like SET_BIT */
+#include "../../gpio/gpio.h"
+
+/* SPI pins of the ATmega32 */
+#define SPI_SS_PIN   B4
+#define SPI_MOSI_PIN B5
+#define SPI_MISO_PIN B6
+#define SPI_SCK_PIN  B7
+
+/* SPCR bits set by SPI_applyConfig */
+#define SPI_SPCR_CONFIG_MASK ((1 << DORD) | (1 << CPOL) | (1 << CPHA) | (1 << SPR1) | (1 << SPR0))
+
+#if (SPI_QUEUE_SIZE < 2) || (SPI_QUEUE_SIZE > 128) \
+    || ((SPI_QUEUE_SIZE & (SPI_QUEUE_SIZE - 1)) != 0)
+#error "SPI_QUEUE_SIZE must be a power of two from 2 to 128"
+#endif
+
+#define SPI_QUEUE_MASK (SPI_QUEUE_SIZE - 1)
+
+#if (SPI_SLAVE_RX_BUFFER_SIZE < 2) || (SPI_SLAVE_RX_BUFFER_SIZE > 128) \
+    || ((SPI_SLAVE_RX_BUFFER_SIZE & (SPI_SLAVE_RX_BUFFER_SIZE - 1)) != 0)
+#error "SPI_SLAVE_RX_BUFFER_SIZE must be a power of two from 2 to 128"
+#endif
+
+#if (SPI_SLAVE_TX_BUFFER_SIZE < 1) || (SPI_SLAVE_TX_BUFFER_SIZE > 255)
+#error "SPI_SLAVE_TX_BUFFER_SIZE must be from 1 to 255"
+#endif
+
+#define SPI_SLAVE_RX_MASK (SPI_SLAVE_RX_BUFFER_SIZE - 1)
+
+/* SPI serial transfer complete interrupt */
+#define SPI_STC_ISR __vector_12
+
+void SPI_STC_ISR(void)__attribute__((signal, used, externally_visible));
+
+/* Transactions submitted, spi_queue[spi_queue_tail] is the one on the bus */
+static SPI_Transaction *spi_queue[SPI_QUEUE_SIZE];
+static volatile uint8 spi_queue_head = 0;
+static volatile uint8 spi_queue_tail = 0;
+static volatile boolean spi_busy = FALSE;
+/* Index of the byte on the bus in the current transaction */
+static uint16 spi_index;
+
+/* Interrupt-driven slave, the STC ISR serves the slave instead of the queue */
+static volatile boolean spi_slave_mode = FALSE;
+static EXTI_Line spi_slave_ss_line;
+static boolean spi_slave_selected;
+/* Bytes received in the frame, saturates at 0xFF */
+static uint8 spi_slave_count;
+/* Byte written to SPDR by the next STC interrupt */
+static uint8 spi_slave_next;
+
+static uint8 spi_slave_rx_buffer[SPI_SLAVE_RX_BUFFER_SIZE];
+static volatile uint8 spi_slave_rx_head = 0;
+static volatile uint8 spi_slave_rx_tail = 0;
+static volatile uint16 spi_slave_overflow_count = 0;
+
+/* Response buffers, spi_slave_tx_front is sent, the other one is filled */
+static uint8 spi_slave_tx_buffers[2][SPI_SLAVE_TX_BUFFER_SIZE];
+static uint8 spi_slave_tx_length[2];
+static uint8 spi_slave_tx_front;
+static volatile boolean spi_slave_tx_ready;
+/* Index of spi_slave_next in the front buffer */
+static uint8 spi_slave_tx_index;
+static SpiFrameCallback spi_slave_frame_callback = NULL_PTR;
+
+/*
+ * Register-map mode, spi_slave_address is the register of spi_slave_next in a read
+ * frame and the next register written in a write frame.
+ */
+static uint8 *spi_slave_map = NULL_PTR;
+static uint8 spi_slave_map_size;
+static SpiRegisterWriteCallback spi_slave_write_callback = NULL_PTR;
+static uint8 spi_slave_command;
+static uint8 spi_slave_address;
+static uint8 spi_slave_write_start;
+static uint8 spi_slave_write_count;
+
+static void SPI_setupMasterPins(void) {
+    /* SS is kept high so it does not select this device as a slave */
+    GPIO_writePin(SPI_SS_PIN, HIGH);
+    GPIO_setupPinDirection(SPI_SS_PIN, PIN_OUTPUT);
+    GPIO_setupPinDirection(SPI_MOSI_PIN, PIN_OUTPUT);
+    GPIO_setupPinDirection(SPI_SCK_PIN, PIN_OUTPUT);
+    GPIO_setupPinDirection(SPI_MISO_PIN, PIN_INPUT);
+}
+
+/* Leave the interrupt-driven slave mode, the SS line is not used any more */
+static void SPI_stopSlave(void) {
+    if (spi_slave_mode) {
+        spi_slave_mode = FALSE;
+        EXTI_disable(spi_slave_ss_line);
+    }
+}
 
 void initMaster() {
     /**    SPCR -> SPIE | SPE  | DORD | MSTR  | CPOL  | CPHA  | SPR1  | SPR0
      *     SPCR -> 0    | 1    | 0    | 1     | 0     | 0     | SPR1  | SPR0
      *     SPSR -> SPIF | WCOL | R    | R     | R     | R     | R     | SPI2X
      * */
+    SPI_stopSlave();
+    SPI_setupMasterPins();
 
     SPCR = 0b01010000; /** Enable SPI in Master MODE */
-    /** DORD    : 0 LSB first
+    /** DORD    : 0 MSB first
      *  CPOL    : 0 Leading Edge Rising
      *  CPHA    : 0 Data Sample With Leading
      *  SPR1:0 & SPI2X  : 0 FCPU/4
@@ -33,11 +128,40 @@ void initMaster() {
     SPSR = 0;
 }
 
+void SPI_initMaster(const SPI_Config *config) {
+    SPI_stopSlave();
+    SPI_setupMasterPins();
+    SPCR = (1 << SPE) | (1 << MSTR);
+    SPI_applyConfig(config);
+}
+
+void SPI_applyConfig(const SPI_Config *config) {
+    /** SPCR -> SPIE | SPE  | DORD | MSTR  | CPOL  | CPHA  | SPR1  | SPR0 */
+    SPCR = (SPCR & ~SPI_SPCR_CONFIG_MASK) | (config->data_order << DORD)
+            | (config->mode << CPHA) | (config->frequency & 0x03);
+    /** SPSR -> SPIF | WCOL | R    | R     | R     | R     | R     | SPI2X, only SPI2X is writable */
+    SPSR = config->frequency >> 2;
+}
+
+void setMasterFrequency(SPI_Master_Freq frequency) {
+    SPCR = (SPCR & ~((1 << SPR1) | (1 << SPR0))) | (frequency & 0x03);
+    SPSR = frequency >> 2;
+}
+
+void setDataOrder(SPI_Data_Order order) {
+    SPCR = (SPCR & ~(1 << DORD)) | (order << DORD);
+}
+
+void SPI_setMode(SPI_Mode mode) {
+    SPCR = (SPCR & ~((1 << CPOL) | (1 << CPHA))) | (mode << CPHA);
+}
+
 void initSlave() {
     /**    SPCR -> SPIE | SPE  | DORD | MSTR  | CPOL  | CPHA  | SPR1  | SPR0
      *     SPCR -> 0    | 1    | 0    | 0     | 0     | 0     | SPR1  | SPR0
      *     SPSR -> SPIF | WCOL | R    | R     | R     | R     | R     | SPI2X
      * */
+    SPI_stopSlave();
     SPCR = 0b01000000; /** Enable SPI in Master MODE */
     /** All settings are 0 to be handled by the Master Device*/
 
@@ -45,10 +169,408 @@ void initSlave() {
 
 uint8 sendReceiveByte(uint8 byte) {
     SPDR = byte;
-    while (BIT_IS_CLEAR(SPCR, 7)); //SPIF PIN 7
+    /* Reading SPSR with SPIF set then SPDR clears SPIF */
+    while (BIT_IS_CLEAR(SPSR, SPIF));
     return SPDR;
 }
 
+void SPI_transfer(const uint8 *tx, uint8 *rx, uint16 length) {
+    uint8 next;
+    uint8 received;
+
+    if (length == 0) {
+        return;
+    }
+
+    SPDR = *tx++;
+    while (--length != 0) {
+        /* Ready before SPIF, the bus is idle only for the write below */
+        next = *tx++;
+        while (BIT_IS_CLEAR(SPSR, SPIF));
+        /* Read then write back to back, the store waits for the next transfer */
+        received = SPDR;
+        SPDR = next;
+        *rx++ = received;
+    }
+    while (BIT_IS_CLEAR(SPSR, SPIF));
+    *rx = SPDR;
+}
+
+void SPI_transmit(const uint8 *tx, uint16 length) {
+    uint8 next;
+
+    if (length == 0) {
+        return;
+    }
+
+    SPDR = *tx++;
+    while (--length != 0) {
+        next = *tx++;
+        while (BIT_IS_CLEAR(SPSR, SPIF));
+        (void) SPDR;
+        SPDR = next;
+    }
+    while (BIT_IS_CLEAR(SPSR, SPIF));
+    /* Read the last byte to clear SPIF like the other transfers */
+    (void) SPDR;
+}
+
+void SPI_receive(uint8 *rx, uint16 length) {
+    uint8 received;
+
+    if (length == 0) {
+        return;
+    }
+
+    SPDR = SPI_FILL_BYTE;
+    while (--length != 0) {
+        while (BIT_IS_CLEAR(SPSR, SPIF));
+        received = SPDR;
+        SPDR = SPI_FILL_BYTE;
+        *rx++ = received;
+    }
+    while (BIT_IS_CLEAR(SPSR, SPIF));
+    *rx = SPDR;
+}
+
+void SPI_initDevice(const SPI_Device *device) {
+    GPIO_writePin(device->cs_pin, HIGH);
+    GPIO_setupPinDirection(device->cs_pin, PIN_OUTPUT);
+}
+
+/* Select the device of transaction and send its first byte, interrupts disabled */
+static void SPI_startTransaction(const SPI_Transaction *transaction) {
+    SPI_applyConfig(&transaction->device->config);
+    GPIO_writePin(transaction->device->cs_pin, LOW);
+    spi_index = 0;
+    SPDR = (transaction->tx != NULL_PTR) ? transaction->tx[0] : SPI_FILL_BYTE;
+}
+
+boolean SPI_submit(SPI_Transaction *transaction) {
+    uint8 head;
+    uint8 sreg;
+
+    if (transaction->length == 0) {
+        return FALSE;
+    }
+
+    sreg = SREG;
+    GLOBAL_INTERRUPT_DISABLE();
+    head = spi_queue_head;
+    if ((uint8) (head - spi_queue_tail) >= SPI_QUEUE_SIZE) {
+        SREG = sreg;
+        return FALSE;
+    }
+    spi_queue[head & SPI_QUEUE_MASK] = transaction;
+    spi_queue_head = head + 1;
+    if (!spi_busy) {
+        spi_busy = TRUE;
+        SPI_startTransaction(transaction);
+        SET_BIT(SPCR, SPIE);
+    }
+    SREG = sreg;
+    return TRUE;
+}
+
+uint8 SPI_getPendingTransactions(void) {
+    return (uint8) (spi_queue_head - spi_queue_tail);
+}
+
+boolean SPI_isBusy(void) {
+    return spi_busy;
+}
+
+/* STC interrupt of the master queue */
+static void SPI_masterTransferComplete(void) {
+    uint8 tail = spi_queue_tail;
+    SPI_Transaction *transaction = spi_queue[tail & SPI_QUEUE_MASK];
+    uint16 index = spi_index;
+    uint8 received;
+
+    /* Entering the ISR cleared SPIF, read the byte then send the next one */
+    received = SPDR;
+    index++;
+    if (index < transaction->length) {
+        SPDR = (transaction->tx != NULL_PTR) ? transaction->tx[index] : SPI_FILL_BYTE;
+    }
+    if (transaction->rx != NULL_PTR) {
+        transaction->rx[index - 1] = received;
+    }
+    if (index < transaction->length) {
+        spi_index = index;
+        return;
+    }
+
+    GPIO_writePin(transaction->device->cs_pin, HIGH);
+    tail++;
+    spi_queue_tail = tail;
+    if (tail != spi_queue_head) {
+        SPI_startTransaction(spi_queue[tail & SPI_QUEUE_MASK]);
+    } else {
+        CLEAR_BIT(SPCR, SPIE);
+        spi_busy = FALSE;
+    }
+
+    /* Called last, the callback may submit the next transaction */
+    if (transaction->callback != NULL_PTR) {
+        transaction->callback(transaction);
+    }
+}
+
+/*******************************************************************************
+ *                      Interrupt-driven slave                                 *
+ *******************************************************************************/
+
+static uint8 SPI_slaveReadRegister(uint8 address) {
+    return (address < spi_slave_map_size) ? spi_slave_map[address] : SPI_FILL_BYTE;
+}
+
+/*
+ * The register pointer stops at the end of the map instead of wrapping back to 0,
+ * so a frame longer than the map never writes before or over its start.
+ */
+static uint8 SPI_slaveNextRegister(uint8 address) {
+    return (address < spi_slave_map_size) ? (uint8) (address + 1) : address;
+}
+
+/* Put the first byte of the next frame in SPDR, SS is high, interrupts disabled */
+static void SPI_slavePreload(void) {
+    const uint8 *response;
+    uint8 length;
+
+    if (spi_slave_map != NULL_PTR) {
+        /* Sent while the command byte is received */
+        SPDR = SPI_FILL_BYTE;
+        spi_slave_next = SPI_FILL_BYTE;
+        return;
+    }
+
+    if (spi_slave_tx_ready) {
+        spi_slave_tx_front ^= 1;
+        spi_slave_tx_ready = FALSE;
+    }
+    response = spi_slave_tx_buffers[spi_slave_tx_front];
+    length = spi_slave_tx_length[spi_slave_tx_front];
+    SPDR = (length > 0) ? response[0] : SPI_FILL_BYTE;
+    spi_slave_next = (length > 1) ? response[1] : SPI_FILL_BYTE;
+    spi_slave_tx_index = 1;
+}
+
+static void SPI_slaveFrameStart(void) {
+    spi_slave_selected = TRUE;
+    spi_slave_count = 0;
+    spi_slave_write_count = 0;
+}
+
+static void SPI_slaveFrameEnd(void) {
+    uint8 count = spi_slave_count;
+
+    spi_slave_selected = FALSE;
+    SPI_slavePreload();
+
+    if (spi_slave_map != NULL_PTR) {
+        if ((spi_slave_write_count != 0) && (spi_slave_write_callback != NULL_PTR)) {
+            spi_slave_write_callback(spi_slave_write_start, spi_slave_write_count);
+        }
+    } else if (spi_slave_frame_callback != NULL_PTR) {
+        spi_slave_frame_callback(count);
+    }
+}
+
+/* EXTI callback of the SS line, the SS level tells the edge */
+static void SPI_slaveSsChanged(void) {
+    uint8 level;
+
+    do {
+        level = GPIO_readPin(SPI_SS_PIN);
+        if (spi_slave_ss_line == EXTI_INT2) {
+            /* INT2 has no any change sense, wait for the other edge */
+            EXTI_setSenseControl(EXTI_INT2,
+                    (level == LOGIC_LOW) ? EXTI_SENSE_RISING_EDGE : EXTI_SENSE_FALLING_EDGE);
+        }
+        if ((level == LOGIC_LOW) && !spi_slave_selected) {
+            SPI_slaveFrameStart();
+        } else if ((level != LOGIC_LOW) && spi_slave_selected) {
+            SPI_slaveFrameEnd();
+        }
+        /* An edge while the sense was changed clears INTF2, check the level again */
+    } while (GPIO_readPin(SPI_SS_PIN) != level);
+}
+
+/* STC interrupt of the slave */
+static void SPI_slaveTransferComplete(void) {
+    uint8 received;
+    uint8 head;
+    uint8 address;
+
+    received = SPDR;
+
+    if (spi_slave_map != NULL_PTR) {
+        address = spi_slave_address;
+        if (spi_slave_count == 0) {
+            /* Command byte, the first register goes out with the next byte */
+            spi_slave_command = received;
+            address = received & SPI_REG_ADDRESS_MASK;
+            spi_slave_write_start = address;
+            if (received & SPI_REG_READ) {
+                SPDR = SPI_slaveReadRegister(address);
+                address = SPI_slaveNextRegister(address);
+                spi_slave_next = SPI_slaveReadRegister(address);
+            } else {
+                SPDR = SPI_FILL_BYTE;
+                spi_slave_next = SPI_FILL_BYTE;
+            }
+        } else {
+            SPDR = spi_slave_next;
+            if (spi_slave_command & SPI_REG_READ) {
+                address = SPI_slaveNextRegister(address);
+                spi_slave_next = SPI_slaveReadRegister(address);
+            } else if (address < spi_slave_map_size) {
+                spi_slave_map[address] = received;
+                spi_slave_write_count++;
+                address = SPI_slaveNextRegister(address);
+            }
+        }
+        spi_slave_address = address;
+    } else {
+        SPDR = spi_slave_next;
+        head = spi_slave_rx_head;
+        if ((uint8) (head - spi_slave_rx_tail) < SPI_SLAVE_RX_BUFFER_SIZE) {
+            spi_slave_rx_buffer[head & SPI_SLAVE_RX_MASK] = received;
+            spi_slave_rx_head = head + 1;
+        } else {
+            spi_slave_overflow_count++;
+        }
+        if (spi_slave_tx_index < spi_slave_tx_length[spi_slave_tx_front]) {
+            spi_slave_tx_index++;
+        }
+        spi_slave_next = (spi_slave_tx_index < spi_slave_tx_length[spi_slave_tx_front]) ?
+                spi_slave_tx_buffers[spi_slave_tx_front][spi_slave_tx_index] : SPI_FILL_BYTE;
+    }
+
+    if (spi_slave_count != 0xFF) {
+        spi_slave_count++;
+    }
+}
+
+void SPI_initSlaveInterrupt(const SPI_SlaveConfig *config) {
+    uint8 sreg = SREG;
+
+    GLOBAL_INTERRUPT_DISABLE();
+    SPI_stopSlave();
+    GPIO_setupPinDirection(SPI_SS_PIN, PIN_INPUT);
+    GPIO_setupPinDirection(SPI_MOSI_PIN, PIN_INPUT);
+    GPIO_setupPinDirection(SPI_SCK_PIN, PIN_INPUT);
+    GPIO_setupPinDirection(SPI_MISO_PIN, PIN_OUTPUT);
+
+    spi_slave_rx_head = 0;
+    spi_slave_rx_tail = 0;
+    spi_slave_overflow_count = 0;
+    spi_slave_tx_length[0] = 0;
+    spi_slave_tx_length[1] = 0;
+    spi_slave_tx_front = 0;
+    spi_slave_tx_ready = FALSE;
+    spi_slave_frame_callback = NULL_PTR;
+    spi_slave_map = NULL_PTR;
+    spi_slave_write_callback = NULL_PTR;
+    spi_slave_selected = FALSE;
+    spi_slave_ss_line = config->ss_line;
+    spi_slave_mode = TRUE;
+
+    /** SPCR -> SPIE | SPE  | DORD | MSTR  | CPOL  | CPHA  | SPR1  | SPR0 */
+    SPCR = (1 << SPIE) | (1 << SPE) | (config->data_order << DORD) | (config->mode << CPHA);
+    SPI_slavePreload();
+
+    EXTI_init(config->ss_line,
+            (config->ss_line == EXTI_INT2) ? EXTI_SENSE_FALLING_EDGE : EXTI_SENSE_ANY_CHANGE);
+    EXTI_setCallback(config->ss_line, SPI_slaveSsChanged);
+    EXTI_enable(config->ss_line);
+    /* The master may already hold SS low */
+    SPI_slaveSsChanged();
+    SREG = sreg;
+}
+
+boolean SPI_slaveSetResponse(const uint8 *data, uint8 length) {
+    uint8 *back;
+    uint8 sreg;
+    uint8 i;
+
+    if (length > SPI_SLAVE_TX_BUFFER_SIZE) {
+        return FALSE;
+    }
+
+    /* The SS interrupt does not swap the buffers while the back one is written */
+    sreg = SREG;
+    GLOBAL_INTERRUPT_DISABLE();
+    spi_slave_tx_ready = FALSE;
+    back = spi_slave_tx_buffers[spi_slave_tx_front ^ 1];
+    SREG = sreg;
+
+    for (i = 0; i < length; i++) {
+        back[i] = data[i];
+    }
+
+    sreg = SREG;
+    GLOBAL_INTERRUPT_DISABLE();
+    spi_slave_tx_length[spi_slave_tx_front ^ 1] = length;
+    spi_slave_tx_ready = TRUE;
+    if (spi_slave_mode && !spi_slave_selected) {
+        SPI_slavePreload();
+    }
+    SREG = sreg;
+    return TRUE;
+}
+
+boolean SPI_slaveRead(uint8 *data) {
+    uint8 tail = spi_slave_rx_tail;
+
+    if (tail == spi_slave_rx_head) {
+        return FALSE;
+    }
+    *data = spi_slave_rx_buffer[tail & SPI_SLAVE_RX_MASK];
+    spi_slave_rx_tail = tail + 1;
+    return TRUE;
+}
+
+uint8 SPI_slaveAvailable(void) {
+    return (uint8) (spi_slave_rx_head - spi_slave_rx_tail);
+}
+
+uint16 SPI_slaveGetOverflowCount(void) {
+    uint16 count;
+    uint8 sreg = SREG;
+
+    GLOBAL_INTERRUPT_DISABLE();
+    count = spi_slave_overflow_count;
+    SREG = sreg;
+    return count;
+}
+
+void SPI_slaveSetFrameCallback(SpiFrameCallback callback) {
+    spi_slave_frame_callback = callback;
+}
+
+void SPI_slaveSetRegisterMap(uint8 *map, uint8 size, SpiRegisterWriteCallback callback) {
+    uint8 sreg = SREG;
+
+    GLOBAL_INTERRUPT_DISABLE();
+    spi_slave_map = map;
+    spi_slave_map_size = size;
+    spi_slave_write_callback = callback;
+    if (spi_slave_mode && !spi_slave_selected) {
+        SPI_slavePreload();
+    }
+    SREG = sreg;
+}
+
+void SPI_STC_ISR(void) {
+    if (spi_slave_mode) {
+        SPI_slaveTransferComplete();
+    } else {
+        SPI_masterTransferComplete();
+    }
+}
+
 void sendString(const uint8 *string) {
     uint8 i = 0;
 
@@ -63,8 +585,9 @@ void receiveString(uint8 *string) {
     uint8 i = 0;
     uint8 data;
     do {
-        data = sendReceiveByte(0xFF);
+        data = sendReceiveByte(SPI_FILL_BYTE);
         string[i] = data;
+        i++;
     } while (data != '\0');
 
 }
@@ -20,9 +20,10 @@
 
 #include "../../../std_types.h"
 #include "../../../common_macros.h"
+#include "../../exti/exti.h"
 
 /**
- @brief Here you can find all the the information related to the Timer0
+ @brief Here you can find all the the information related to the SPI
  hardware found in the official data sheet.
 
  REGISTERS:
@@ -111,10 +112,76 @@
 
  */
 
+/*
+ Block transfers (SPI_transfer / SPI_transmit / SPI_receive)
+ The SPI is single buffered for transmit and double buffered for receive, so
+ the loop loads the next byte before waiting, then reads the received byte and
+ writes the next one back to back as soon as SPIF sets. The bus is only idle for
+ the SPIF poll and the IN/OUT pair (3 - 4 cycles); the received byte is stored
+ while the next one is on the bus.
+
+ Throughput at F_CPU = 8 MHz, fosc/2 (500 kB/s on the wire), cycles per byte
+ counted from the instruction timing of the loops (avr-gcc -Os):
+ ---------------------------------------------------------------------
+ Function                          | cycles/byte |  bytes/s  | wire  |
+ ---------------------------------------------------------------------
+ sendReceiveByte loop (sendString) |   ~34       |  ~235 k   |  47 % |
+ SPI_transfer                      |   ~20       |  ~400 k   |  80 % |
+ SPI_transmit / SPI_receive        |   ~20       |  ~400 k   |  80 % |
+ ---------------------------------------------------------------------
+ The figures are estimates, Benchmarks/benchmark.c (make benchmark-avr) measures
+ SPI_transfer on the target with the profiler.
+
+ SPI_FILL_BYTE is sent by SPI_receive while reading.
+ */
+#define SPI_FILL_BYTE 0xFF
+
+/*
+ Transaction queue (SPI_submit)
+ Every device on the bus has its own chip-select pin and SPI_Config. The queued
+ transactions are moved by the SPI serial transfer complete interrupt (SPIE): it
+ reads the received byte and writes the next one, so the CPU runs other code between
+ the bytes. Before a transaction the interrupt applies the device setting to SPCR /
+ SPSR and drives its CS low, after the last byte it drives CS high and calls the
+ callback. SPI_QUEUE_SIZE transactions can wait (power of two, 2 to 128).
+ */
+#define SPI_QUEUE_SIZE 4
+
+/*
+ Interrupt-driven slave (SPI_initSlaveInterrupt)
+ The master owns the clock, so the next byte must be in SPDR before it starts the
+ next byte. The STC interrupt first reads the received byte and writes the byte
+ prepared during the previous interrupt, then prepares the following one. With the
+ interrupt entry the master must leave about 60 cycles (8 us at 8 MHz) between bytes.
+ SS (PB4) must also be wired to an external interrupt line (e.g. INT2 on PB2): the SS
+ edges frame the transfers. SS high resets the SPI logic, so a frame always starts
+ with a whole byte.
+
+ Stream mode: the received bytes go to a ring of SPI_SLAVE_RX_BUFFER_SIZE bytes
+ (power of two, 2 to 128) read with SPI_slaveRead. The bytes sent in a frame come
+ from the response buffer, SPI_FILL_BYTE after its end. SPI_slaveSetResponse fills
+ the second buffer while the first one is sent, the buffers are swapped when SS goes
+ high, so a frame never mixes two responses.
+
+ Register-map mode (SPI_slaveSetRegisterMap): the first byte of a frame is a command,
+ SPI_REG_READ | address reads the registers from address on, address alone writes
+ the next bytes to them. The address is incremented after every byte. The first
+ register read must be found during the interrupt of the command byte, so the master
+ waits about 80 cycles (10 us at 8 MHz) after it.
+ */
+#define SPI_SLAVE_RX_BUFFER_SIZE 32
+#define SPI_SLAVE_TX_BUFFER_SIZE 32
+
+#define SPI_REG_READ         0x80
+#define SPI_REG_ADDRESS_MASK 0x7F
+
 //#define  SPCR (*(volatile uint8 *)((0x0D) + 0x20))
 //#define  SPSR (*(volatile uint8 *)((0x0E) + 0x20))
 //#define  SPDR (*(volatile uint8 *)((0x0F) + 0x20))
 
+/*
+ * The value is SPI2X << 2 | SPR1:0, see the table above.
+ */
 typedef enum {
     SPI_FCPU_4,
     SPI_FCPU_16,
@@ -129,16 +196,188 @@ typedef enum {
     SPI_MSB, SPI_LSB,
 } SPI_Data_Order;
 
+/*
+ * The value is CPOL << 1 | CPHA.
+ */
+typedef enum {
+    SPI_MODE_0, /**< SCK idle low,  sample on the rising (leading) edge */
+    SPI_MODE_1, /**< SCK idle low,  sample on the falling (trailing) edge */
+    SPI_MODE_2, /**< SCK idle high, sample on the falling (leading) edge */
+    SPI_MODE_3, /**< SCK idle high, sample on the rising (trailing) edge */
+} SPI_Mode;
+
+/**
+ * @brief the bus setting of one device, applied with SPI_applyConfig when a
+ * transaction with this device starts.
+ */
+typedef struct {
+    SPI_Master_Freq frequency;
+    SPI_Mode mode;
+    SPI_Data_Order data_order;
+} SPI_Config;
+
+/**
+ * @brief a device on the bus: its chip-select pin (GPIO pin number, e.g. B3, active
+ * low) and its bus setting.
+ */
+typedef struct {
+    uint8 cs_pin;
+    SPI_Config config;
+} SPI_Device;
+
+typedef struct SPI_Transaction SPI_Transaction;
+
+/**
+ * @brief called from the SPI interrupt when the transaction is done and CS is high
+ * again, the transaction and its buffers belong to the caller again.
+ */
+typedef void (*SpiTransactionCallback)(SPI_Transaction *transaction);
+
+/**
+ * @brief a transfer of length bytes with device. tx NULL_PTR sends SPI_FILL_BYTE,
+ * rx NULL_PTR drops the received bytes, rx may be the same buffer as tx.
+ * callback may be NULL_PTR.
+ */
+struct SPI_Transaction {
+    const SPI_Device *device;
+    const uint8 *tx;
+    uint8 *rx;
+    uint16 length;
+    SpiTransactionCallback callback;
+};
+
+/**
+ * @brief the slave setting, the clock rate is set by the master.
+ */
+typedef struct {
+    SPI_Mode mode;
+    SPI_Data_Order data_order;
+    EXTI_Line ss_line; /**< external interrupt line wired to SS (PB4) */
+} SPI_SlaveConfig;
+
+/**
+ * @brief called from the SS interrupt when a stream mode frame ends, length is the
+ * number of bytes received in the frame (at most 255 are counted).
+ */
+typedef void (*SpiFrameCallback)(uint8 length);
+
+/**
+ * @brief called from the SS interrupt when a register-map frame that wrote count
+ * registers from address ends.
+ */
+typedef void (*SpiRegisterWriteCallback)(uint8 address, uint8 count);
+
+/**
+ * @brief enable the SPI as master with fosc/4, mode 0 and MSB first.
+ * SCK, MOSI and SS are outputs and MISO is an input. SS must stay an output
+ * (or be held high), a low SS input switches the SPI to slave mode.
+ */
 void initMaster();
 
+/**
+ * @brief enable the SPI as master with the given setting, pins as initMaster.
+ */
+void SPI_initMaster(const SPI_Config *config);
+
+/**
+ * @brief write SPCR and SPSR for the device setting, keeps the SPI master enabled
+ * and the interrupt enable as it is. Call it before selecting the device.
+ */
+void SPI_applyConfig(const SPI_Config *config);
+
 void setMasterFrequency(SPI_Master_Freq);
 
 void setDataOrder(SPI_Data_Order);
 
+void SPI_setMode(SPI_Mode mode);
+
 void initSlave();
 
+/**
+ * @brief start the transfer of byte, wait for SPIF and return the received byte.
+ */
 uint8 sendReceiveByte(uint8);
 
+/**
+ * @brief full-duplex block transfer: send length bytes of tx and store the received
+ * bytes in rx. rx may be the same buffer as tx (in place).
+ */
+void SPI_transfer(const uint8 *tx, uint8 *rx, uint16 length);
+
+/**
+ * @brief send length bytes of tx, the received bytes are dropped.
+ */
+void SPI_transmit(const uint8 *tx, uint16 length);
+
+/**
+ * @brief receive length bytes in rx while sending SPI_FILL_BYTE.
+ */
+void SPI_receive(uint8 *rx, uint16 length);
+
+/**
+ * @brief make the CS pin of device an output driven high (not selected).
+ */
+void SPI_initDevice(const SPI_Device *device);
+
+/**
+ * @brief queue transaction for the SPI interrupt, it starts at once if the bus is
+ * free. SPI_initMaster and SPI_initDevice must be called first and the global
+ * interrupts enabled. The transaction is used in place and must stay unchanged
+ * until its callback. Return FALSE if length is 0 or SPI_QUEUE_SIZE transactions
+ * are already waiting.
+ * The blocking functions must not be used while SPI_isBusy returns TRUE.
+ */
+boolean SPI_submit(SPI_Transaction *transaction);
+
+/**
+ * @brief return the number of submitted transactions not done yet.
+ */
+uint8 SPI_getPendingTransactions(void);
+
+/**
+ * @brief return TRUE while the interrupt is moving a transaction.
+ */
+boolean SPI_isBusy(void);
+
+/**
+ * @brief enable the SPI as a slave driven by the STC interrupt in the stream mode.
+ * MISO is an output, SS, MOSI and SCK are inputs, the pin of config->ss_line is an
+ * input and its interrupt is enabled. The global interrupts must be enabled.
+ */
+void SPI_initSlaveInterrupt(const SPI_SlaveConfig *config);
+
+/**
+ * @brief copy length bytes to the response sent in the next frame, the current
+ * frame is not changed. Return FALSE if length is more than SPI_SLAVE_TX_BUFFER_SIZE.
+ */
+boolean SPI_slaveSetResponse(const uint8 *data, uint8 length);
+
+/**
+ * @brief take the oldest received byte, return FALSE if the ring is empty.
+ */
+boolean SPI_slaveRead(uint8 *data);
+
+/**
+ * @brief return the number of received bytes waiting in the ring.
+ */
+uint8 SPI_slaveAvailable(void);
+
+/**
+ * @brief return the number of bytes dropped because the ring was full.
+ */
+uint16 SPI_slaveGetOverflowCount(void);
+
+void SPI_slaveSetFrameCallback(SpiFrameCallback callback);
+
+/**
+ * @brief switch the slave to the register-map mode on the size registers of map,
+ * used in place. The reads outside of the map send SPI_FILL_BYTE and the writes are
+ * dropped, the register pointer stops at the end of the map and never wraps around
+ * in a long frame. callback may be NULL_PTR. A map of NULL_PTR goes back to the stream mode.
+ * A register of more than one byte must be read with the interrupts disabled.
+ */
+void SPI_slaveSetRegisterMap(uint8 *map, uint8 size, SpiRegisterWriteCallback callback);
+
 void sendString(const uint8*);
 
 void receiveString(uint8*);
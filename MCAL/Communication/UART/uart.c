@@ -16,7 +16,218 @@
 
 #include "uart.h"
 #include "../../Atmega32_Registers.h"
-#include "..\..\..\common_macros.h" /* To use the macros like SET_BIT */ /* To use the macros like SET_BIT */
+#include "../../gpio/gpio.h"
+#include "../../../common_macros.h" /* To use the macros like SET_BIT */ /* To use the macros like SET_BIT */
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/*
+ * The ring indexes are free running uint8 counters, the used size is head - tail
+ * and the array index is the counter masked by size - 1. This works when the size
+ * is a power of two that divides 256.
+ */
+#if (UART_RX_BUFFER_SIZE < 2) || (UART_RX_BUFFER_SIZE > 128) \
+	|| ((UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) != 0)
+#error "UART_RX_BUFFER_SIZE must be a power of two from 2 to 128"
+#endif
+
+#if (UART_TX_BUFFER_SIZE < 2) || (UART_TX_BUFFER_SIZE > 128) \
+	|| ((UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) != 0)
+#error "UART_TX_BUFFER_SIZE must be a power of two from 2 to 128"
+#endif
+
+#if (UART_ASYNC_QUEUE_SIZE < 2) || (UART_ASYNC_QUEUE_SIZE > 128) \
+	|| ((UART_ASYNC_QUEUE_SIZE & (UART_ASYNC_QUEUE_SIZE - 1)) != 0)
+#error "UART_ASYNC_QUEUE_SIZE must be a power of two from 2 to 128"
+#endif
+
+#define UART_RX_MASK (UART_RX_BUFFER_SIZE - 1)
+#define UART_TX_MASK (UART_TX_BUFFER_SIZE - 1)
+#define UART_ASYNC_MASK (UART_ASYNC_QUEUE_SIZE - 1)
+
+/* UCSRA bits written back by the masked writes, the flags are written as zero */
+#define UART_UCSRA_SETTINGS ((1 << U2X) | (1 << MPCM))
+
+/*******************************************************************************
+ *                      Types Declaration                                      *
+ *******************************************************************************/
+
+/*
+ * Block queued by UART_sendAsync, it is started when the TX ring tail reaches
+ * position, the ring head when it was queued.
+ */
+typedef struct {
+	const uint8 *data;
+	uint16 length;
+	UartSendCallback callback;
+	uint8 position;
+} UART_AsyncBlock;
+
+/*******************************************************************************
+ *                      Private Variables                                      *
+ *******************************************************************************/
+
+static boolean uart_interrupt_mode = FALSE;
+
+/* Current baud rate setting, for UART_getBaudRate */
+static uint16 uart_ubrr = 0;
+static boolean uart_double_speed = FALSE;
+
+/*
+ * Single producer / single consumer rings, each index is written by one side only:
+ * RX: head by the RXC ISR, tail by UART_read
+ * TX: head by UART_write, tail by the UDRE ISR
+ */
+static uint8 uart_rx_buffer[UART_RX_BUFFER_SIZE];
+static volatile uint8 uart_rx_head = 0;
+static volatile uint8 uart_rx_tail = 0;
+
+static uint8 uart_tx_buffer[UART_TX_BUFFER_SIZE];
+static volatile uint8 uart_tx_head = 0;
+static volatile uint8 uart_tx_tail = 0;
+
+static volatile UART_ErrorCounters uart_errors = { 0, 0, 0 };
+
+static volatile UartReceiveCallback uart_receive_callback = NULL_PTR;
+
+/*
+ * UART_sendAsync queue, head by UART_sendAsync, tail by the UDRE ISR once the block
+ * is written. The block in progress is only used by the UDRE ISR.
+ */
+static UART_AsyncBlock uart_async_queue[UART_ASYNC_QUEUE_SIZE];
+static volatile uint8 uart_async_head = 0;
+static volatile uint8 uart_async_tail = 0;
+static const uint8 *uart_async_data;
+static uint16 uart_async_remaining = 0;
+
+/*
+ * Flow control:
+ * uart_rx_stopped : the peer was told to stop (RTS high / XOFF queued)
+ * uart_tx_paused  : the peer told us to stop with XOFF
+ * uart_flow_char  : XON/XOFF waiting for the UDRE ISR, 0 if none
+ */
+static UART_FlowControlMode uart_flow_mode = UART_FLOW_NONE;
+static uint8 uart_rts_pin;
+static uint8 uart_cts_pin;
+static uint8 uart_rx_high_watermark;
+static uint8 uart_rx_low_watermark;
+static volatile boolean uart_rx_stopped = FALSE;
+static volatile boolean uart_tx_paused = FALSE;
+static volatile uint8 uart_flow_char = 0;
+
+/*
+ * Multi-drop mode, one bit per TX ring place marks the address frames.
+ * The bits are set by UART_sendAddress and cleared by the UDRE ISR when sent.
+ */
+static boolean uart_multidrop = FALSE;
+static volatile uint8 uart_address = UART_NO_ADDRESS;
+static uint8 uart_de_pin = UART_NO_DE_PIN;
+static volatile uint8 uart_tx_address_frames[(UART_TX_BUFFER_SIZE + 7) / 8];
+
+/*******************************************************************************
+ *                      Private Functions                                      *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Increment an error counter without wrapping back to zero.
+ */
+static void UART_countError(volatile uint16 *counter) {
+	if (*counter != 0xFFFF) {
+		(*counter)++;
+	}
+}
+
+/*
+ * Description :
+ * Check the error flags of the received byte, they must be read before UDR.
+ * Return TRUE if the byte in UDR is valid.
+ */
+static boolean UART_checkReceiveErrors(uint8 status) {
+	if (BIT_IS_SET(status, DOR)) {
+		UART_countError(&uart_errors.overrun);
+	}
+	if (BIT_IS_SET(status, FE)) {
+		UART_countError(&uart_errors.framing);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Write the MPCM bit without clearing the TXC flag, SBI/CBI on UCSRA would
+ * write it back as one.
+ */
+static void UART_setMpcm(boolean enable) {
+	UCSRA = (UCSRA & (1 << U2X)) | (enable ? (1 << MPCM) : 0);
+}
+
+/*
+ * Description :
+ * Let the UDRE ISR send the queued bytes and blocks.
+ */
+static void UART_startTransmit(void) {
+	if (uart_multidrop) {
+		/* Take the bus before the UDRE ISR writes the first byte */
+		GPIO_setPinAtomic(uart_de_pin);
+	}
+	SET_BIT(UCSRB, UDRIE);
+}
+
+/*
+ * Description :
+ * Ask the peer to stop sending, called from the RXC ISR.
+ */
+static void UART_stopReceive(void) {
+	uart_rx_stopped = TRUE;
+	if (uart_flow_mode == UART_FLOW_RTS_CTS) {
+		GPIO_setPinAtomic(uart_rts_pin);
+	} else {
+		uart_flow_char = UART_XOFF;
+		SET_BIT(UCSRB, UDRIE);
+	}
+}
+
+/*
+ * Description :
+ * Let the peer send again once the RX ring is down to the low watermark.
+ */
+static void UART_resumeReceive(void) {
+	uint8 sreg = SREG;
+
+	/* The RXC ISR moves the head and may stop the peer meanwhile */
+	GLOBAL_INTERRUPT_DISABLE();
+	if (uart_rx_stopped
+			&& ((uint8) (uart_rx_head - uart_rx_tail) <= uart_rx_low_watermark)) {
+		uart_rx_stopped = FALSE;
+		if (uart_flow_mode == UART_FLOW_RTS_CTS) {
+			GPIO_clearPinAtomic(uart_rts_pin);
+		} else {
+			/* Replaces an XOFF not sent yet */
+			uart_flow_char = UART_XON;
+			SET_BIT(UCSRB, UDRIE);
+		}
+	}
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Return TRUE if the peer accepts data.
+ */
+static boolean UART_transmitAllowed(void) {
+	switch (uart_flow_mode) {
+	case UART_FLOW_RTS_CTS:
+		return (GPIO_readPin(uart_cts_pin) == LOGIC_LOW);
+	case UART_FLOW_XON_XOFF:
+		return !uart_tx_paused;
+	default:
+		return TRUE;
+	}
+}
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -30,10 +241,27 @@
  * 3. Setup the UART baud rate.
  */
 void UART_init(uint32 baud_rate) {
-	uint16 ubrr_value = 0;
+	UART_BaudSetting setting;
+
+	/* Use the closest setting even when it is above UART_BAUD_TOLERANCE */
+	UART_solveBaud(baud_rate, &setting);
+	UART_initSetting(setting.ubrr, setting.double_speed);
+}
+
+/*
+ * Description :
+ * Initialize the UART with an already solved baud rate setting.
+ */
+void UART_initSetting(uint16 ubrr_value, boolean double_speed) {
+	uart_ubrr = ubrr_value;
+	uart_double_speed = double_speed;
+
+	/* Polled mode, leave the ring and 9-bit paths of an earlier init */
+	uart_interrupt_mode = FALSE;
+	uart_multidrop = FALSE;
 
 	/* U2X = 1 for double transmission speed */
-	UCSRA = (1 << U2X);
+	UCSRA = double_speed ? (1 << U2X) : 0;
 
 	/************************** UCSRB Description **************************
 	 * RXCIE = 0 Disable USART RX Complete Interrupt Enable
@@ -56,19 +284,127 @@ void UART_init(uint32 baud_rate) {
 	 ***********************************************************************/
 	UCSRC = (1 << URSEL) | (1 << UCSZ0) | (1 << UCSZ1);
 
-	/* Calculate the UBRR register value */
-	ubrr_value = (uint16) (((F_CPU / (baud_rate * 8UL))) - 1);
-
 	/* First 8 bits from the BAUD_PRESCALE inside UBRRL and last 4 bits in UBRRH*/
 	UBRRH = ubrr_value >> 8;
 	UBRRL = ubrr_value;
 }
 
+/*
+ * Description :
+ * Find the UBRR and U2X values with the smallest error for baud_rate at F_CPU,
+ * with the same formulas as the compile time solver in uart.h.
+ */
+boolean UART_solveBaud(uint32 baud_rate, UART_BaudSetting *setting) {
+	uint32 error_normal;
+	uint32 error_double;
+	uint32 divider;
+
+	if (baud_rate == 0) {
+		/* No setting, report the slowest one */
+		setting->double_speed = FALSE;
+		setting->ubrr = 4095;
+		setting->achieved_baud = (F_CPU + (16UL * 4096UL) / 2) / (16UL * 4096UL);
+		setting->error = 0xFFFF;
+		return FALSE;
+	}
+
+	error_normal = UART_ERROR_FOR(baud_rate, 16UL);
+	error_double = UART_ERROR_FOR(baud_rate, 8UL);
+	setting->double_speed = (error_double < error_normal);
+	divider = setting->double_speed ? 8UL : 16UL;
+	setting->error = setting->double_speed ? error_double : error_normal;
+
+	if (UART_UBRR_VALID(baud_rate, divider)) {
+		setting->ubrr = (uint16) UART_UBRR_FOR(baud_rate, divider);
+	} else {
+		/* Baud rate out of range for both speeds, use the nearest limit */
+		setting->double_speed = (baud_rate > (F_CPU / (16UL * 4096UL)));
+		setting->ubrr = setting->double_speed ? 0 : 4095;
+		divider = setting->double_speed ? 8UL : 16UL;
+	}
+	setting->achieved_baud = (F_CPU + (divider * (setting->ubrr + 1UL)) / 2)
+			/ (divider * (setting->ubrr + 1UL));
+
+	return (setting->error <= UART_BAUD_TOLERANCE);
+}
+
+/*
+ * Description :
+ * Return the achieved baud rate of the current UART setting.
+ */
+uint32 UART_getBaudRate(void) {
+	uint32 divider = uart_double_speed ? 8UL : 16UL;
+
+	return (F_CPU + (divider * (uart_ubrr + 1UL)) / 2) / (divider * (uart_ubrr + 1UL));
+}
+
+/*
+ * Description :
+ * Change UBRR and U2X without changing the frame format or the mode.
+ */
+void UART_setBaudSetting(const UART_BaudSetting *setting) {
+	uint8 sreg = SREG;
+
+	uart_ubrr = setting->ubrr;
+	uart_double_speed = setting->double_speed;
+
+	/* UCSRA is also written by the UART ISRs */
+	GLOBAL_INTERRUPT_DISABLE();
+	UBRRH = setting->ubrr >> 8;
+	UBRRL = setting->ubrr;
+	UCSRA = (UCSRA & (1 << MPCM)) | (setting->double_speed ? (1 << U2X) : 0);
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Enable or disable the receiver.
+ */
+void UART_enableReceiver(boolean enable) {
+	if (enable) {
+		SET_BIT(UCSRB, RXEN);
+	} else {
+		CLEAR_BIT(UCSRB, RXEN);
+	}
+}
+
+/*
+ * Description :
+ * Initialize the UART like UART_init, then switch it to the interrupt mode.
+ */
+void UART_initInterrupt(uint32 baud_rate) {
+	UART_init(baud_rate);
+
+	uart_rx_head = 0;
+	uart_rx_tail = 0;
+	uart_tx_head = 0;
+	uart_tx_tail = 0;
+	uart_async_head = 0;
+	uart_async_tail = 0;
+	uart_async_remaining = 0;
+	uart_flow_mode = UART_FLOW_NONE;
+	uart_rx_stopped = FALSE;
+	uart_tx_paused = FALSE;
+	uart_flow_char = 0;
+	uart_interrupt_mode = TRUE;
+	uart_multidrop = FALSE;
+
+	/* RXCIE = 1 Enable USART RX Complete Interrupt, UDRIE is enabled by UART_write */
+	SET_BIT(UCSRB, RXCIE);
+}
+
 /*
  * Description :
  * Functional responsible for send byte to another UART device.
  */
 void UART_sendByte(const uint8 data) {
+	if (uart_interrupt_mode) {
+		/* Wait for a free place in the TX ring, the UDRE ISR writes UDR */
+		while (UART_write(&data, 1) == 0) {
+		}
+		return;
+	}
+
 	/*
 	 * UDRE flag is set when the Tx buffer (UDR) is empty and ready for
 	 * transmitting a new byte so wait until this flag is set to one
@@ -94,6 +430,15 @@ void UART_sendByte(const uint8 data) {
  * Functional responsible for receive byte from another UART device.
  */
 uint8 UART_recieveByte(void) {
+	uint8 data;
+
+	if (uart_interrupt_mode) {
+		/* Wait until the RXC ISR stores a byte in the RX ring */
+		while (UART_read(&data, 1) == 0) {
+		}
+		return data;
+	}
+
 	/* RXC flag is set when the UART receive data so wait until this flag is set to one */
 	while (BIT_IS_CLEAR(UCSRA, RXC)) {
 	}
@@ -145,3 +490,395 @@ void UART_receiveString(uint8 *Str) {
 	/* After receiving the whole string plus the '#', replace the '#' with '\0' */
 	Str[i] = '\0';
 }
+
+/*
+ * Description :
+ * Non-blocking send, queue as many bytes as possible and return their number.
+ */
+uint16 UART_write(const uint8 *data, uint16 length) {
+	uint16 count = 0;
+	uint8 head;
+
+	if (!uart_interrupt_mode) {
+		/* Only write while the UART transmit buffer is empty */
+		while ((count < length) && BIT_IS_SET(UCSRA, UDRE)) {
+			UDR = data[count];
+			count++;
+		}
+		return count;
+	}
+
+	head = uart_tx_head;
+	while ((count < length) && ((uint8) (head - uart_tx_tail) < UART_TX_BUFFER_SIZE)) {
+		uart_tx_buffer[head & UART_TX_MASK] = data[count];
+		head++;
+		count++;
+	}
+
+	if (count != 0) {
+		/* Publish the bytes, then let the UDRE ISR send them */
+		uart_tx_head = head;
+		UART_startTransmit();
+	}
+	return count;
+}
+
+/*
+ * Description :
+ * Non-blocking receive, copy up to max_length received bytes and return their number.
+ */
+uint16 UART_read(uint8 *data, uint16 max_length) {
+	uint16 count = 0;
+	uint8 tail;
+	uint8 status;
+	uint8 byte;
+
+	if (!uart_interrupt_mode) {
+		while ((count < max_length) && BIT_IS_SET(UCSRA, RXC)) {
+			status = UCSRA;
+			byte = UDR;
+			if (UART_checkReceiveErrors(status)) {
+				data[count] = byte;
+				count++;
+			}
+		}
+		return count;
+	}
+
+	tail = uart_rx_tail;
+	while ((count < max_length) && (tail != uart_rx_head)) {
+		data[count] = uart_rx_buffer[tail & UART_RX_MASK];
+		tail++;
+		count++;
+	}
+
+	/* Give the places back to the RXC ISR */
+	uart_rx_tail = tail;
+	if (uart_rx_stopped) {
+		UART_resumeReceive();
+	}
+	return count;
+}
+
+/*
+ * Description :
+ * Copy the receive error counters, then clear them if clear is TRUE.
+ */
+void UART_getErrorCounters(UART_ErrorCounters *counters, boolean clear) {
+	uint8 sreg = SREG;
+
+	/* The 16-bit counters are updated by the RXC ISR */
+	GLOBAL_INTERRUPT_DISABLE();
+	counters->overrun = uart_errors.overrun;
+	counters->framing = uart_errors.framing;
+	counters->dropped = uart_errors.dropped;
+	if (clear) {
+		uart_errors.overrun = 0;
+		uart_errors.framing = 0;
+		uart_errors.dropped = 0;
+	}
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Pass every received byte to callback from the RXC ISR, NULL_PTR goes back to the ring.
+ */
+void UART_setReceiveCallback(UartReceiveCallback callback) {
+	uart_receive_callback = callback;
+}
+
+/*
+ * Description :
+ * Enable flow control in the interrupt mode.
+ */
+void UART_setFlowControl(const UART_FlowControlConfig *config) {
+	uint8 sreg = SREG;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	uart_flow_mode = config->mode;
+	uart_rts_pin = config->rts_pin;
+	uart_cts_pin = config->cts_pin;
+	uart_rx_high_watermark = config->high_watermark;
+	uart_rx_low_watermark = config->low_watermark;
+	uart_rx_stopped = FALSE;
+	uart_tx_paused = FALSE;
+	uart_flow_char = 0;
+
+	if (uart_flow_mode == UART_FLOW_RTS_CTS) {
+		/* Ready to receive */
+		GPIO_writePin(uart_rts_pin, LOW);
+		GPIO_setupPinDirection(uart_rts_pin, PIN_OUTPUT);
+		GPIO_setupPinDirection(uart_cts_pin, PIN_INPUT);
+	}
+	SREG = sreg;
+
+	/* The ring may already be above the high watermark */
+	if ((uart_flow_mode != UART_FLOW_NONE)
+			&& ((uint8) (uart_rx_head - uart_rx_tail) >= uart_rx_high_watermark)) {
+		GLOBAL_INTERRUPT_DISABLE();
+		UART_stopReceive();
+		SREG = sreg;
+	}
+}
+
+/*
+ * Description :
+ * Restart the transmission stopped by CTS high.
+ */
+void UART_checkCts(void) {
+	if (UART_transmitAllowed()) {
+		/* The UDRE ISR disables itself again if nothing is queued */
+		SET_BIT(UCSRB, UDRIE);
+	}
+}
+
+/*
+ * Description :
+ * Zero-copy send, queue a block for the UDRE ISR.
+ */
+boolean UART_sendAsync(const uint8 *data, uint16 length, UartSendCallback callback) {
+	uint8 head = uart_async_head;
+	UART_AsyncBlock *block;
+
+	if (!uart_interrupt_mode || (length == 0)
+			|| ((uint8) (head - uart_async_tail) >= UART_ASYNC_QUEUE_SIZE)) {
+		return FALSE;
+	}
+
+	block = &uart_async_queue[head & UART_ASYNC_MASK];
+	block->data = data;
+	block->length = length;
+	block->callback = callback;
+	/* Sent after the ring bytes already queued, before the next ones */
+	block->position = uart_tx_head;
+
+	/* Publish the block, then let the UDRE ISR send it */
+	uart_async_head = head + 1;
+	UART_startTransmit();
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the number of UART_sendAsync blocks not completely written yet.
+ */
+uint8 UART_getPendingBlocks(void) {
+	return (uint8) (uart_async_head - uart_async_tail);
+}
+
+/*
+ * Description :
+ * Initialize the UART in the interrupt mode with 9-bit frames for a multi-drop bus.
+ */
+void UART_initMultidrop(uint32 baud_rate, const UART_MultidropConfig *config) {
+	uint8 i;
+
+	UART_initInterrupt(baud_rate);
+
+	for (i = 0; i < sizeof(uart_tx_address_frames); i++) {
+		uart_tx_address_frames[i] = 0;
+	}
+
+	/* Release the bus until there is something to send */
+	uart_de_pin = config->de_pin;
+	if (uart_de_pin != UART_NO_DE_PIN) {
+		GPIO_writePin(uart_de_pin, LOW);
+		GPIO_setupPinDirection(uart_de_pin, PIN_OUTPUT);
+	}
+
+	/*
+	 * UCSZ2 = 1 with UCSZ1:0 = 11 for 9-bit data mode
+	 * TXCIE = 1 to release the driver enable pin after the last frame
+	 */
+	UCSRB |= (1 << UCSZ2) | (1 << TXCIE);
+	uart_multidrop = TRUE;
+	UART_setMultidropAddress(config->address);
+}
+
+/*
+ * Description :
+ * Queue an address frame (ninth bit = 1), waits for a free place in the TX ring.
+ */
+void UART_sendAddress(uint8 address) {
+	uint8 index;
+	uint8 sreg;
+
+	/* Only the main line adds bytes, so the free place stays free */
+	while ((uint8) (uart_tx_head - uart_tx_tail) >= UART_TX_BUFFER_SIZE) {
+	}
+
+	index = uart_tx_head & UART_TX_MASK;
+	sreg = SREG;
+	/* The UDRE ISR clears the bits of the same byte */
+	GLOBAL_INTERRUPT_DISABLE();
+	uart_tx_address_frames[index >> 3] |= (1 << (index & 7));
+	SREG = sreg;
+
+	UART_write(&address, 1);
+}
+
+/*
+ * Description :
+ * Change the own address of the multi-drop mode, the receiver waits for the next
+ * address frame.
+ */
+void UART_setMultidropAddress(uint8 address) {
+	uint8 sreg = SREG;
+
+	/* UCSRA is also written by the RXC ISR */
+	GLOBAL_INTERRUPT_DISABLE();
+	uart_address = address;
+	UART_setMpcm(address != UART_NO_ADDRESS);
+	SREG = sreg;
+}
+
+/*******************************************************************************
+ *                      Interrupt Service Routines                             *
+ *******************************************************************************/
+
+/**
+ * @brief store the received byte in the RX ring buffer, or pass it to the receive callback.
+ *
+ */
+#define UART_RXC_ISR __vector_13
+
+void UART_RXC_ISR(void)__attribute__((signal, used, externally_visible));
+
+void UART_RXC_ISR(void) {
+	uint8 status = UCSRA;
+	/* The ninth bit must be read before UDR */
+	uint8 address_frame = uart_multidrop ? (UCSRB & (1 << RXB8)) : 0;
+	uint8 data = UDR;
+	uint8 head = uart_rx_head;
+
+	if (!UART_checkReceiveErrors(status)) {
+		return;
+	}
+
+	if (address_frame) {
+		/* Wake up for the own and the broadcast address, else sleep until the next one */
+		if (uart_address != UART_NO_ADDRESS) {
+			UART_setMpcm((data != uart_address) && (data != UART_BROADCAST_ADDRESS));
+		}
+		return;
+	}
+
+	if (uart_flow_mode == UART_FLOW_XON_XOFF) {
+		if (data == UART_XOFF) {
+			uart_tx_paused = TRUE;
+			return;
+		}
+		if (data == UART_XON) {
+			uart_tx_paused = FALSE;
+			SET_BIT(UCSRB, UDRIE);
+			return;
+		}
+	}
+
+	if (uart_receive_callback != NULL_PTR) {
+		uart_receive_callback(data);
+		return;
+	}
+
+	if ((uint8) (head - uart_rx_tail) < UART_RX_BUFFER_SIZE) {
+		uart_rx_buffer[head & UART_RX_MASK] = data;
+		head++;
+		uart_rx_head = head;
+	} else {
+		UART_countError(&uart_errors.dropped);
+	}
+
+	if ((uart_flow_mode != UART_FLOW_NONE) && !uart_rx_stopped
+			&& ((uint8) (head - uart_rx_tail) >= uart_rx_high_watermark)) {
+		UART_stopReceive();
+	}
+}
+
+/**
+ * @brief send the next byte of the UART_sendAsync block or of the TX ring buffer,
+ * stop when both are empty.
+ *
+ */
+#define UART_UDRE_ISR __vector_14
+
+void UART_UDRE_ISR(void)__attribute__((signal, used, externally_visible));
+
+void UART_UDRE_ISR(void) {
+	uint8 tail = uart_tx_tail;
+	uint8 index = tail & UART_TX_MASK;
+	uint8 async_tail = uart_async_tail;
+	UART_AsyncBlock *block = &uart_async_queue[async_tail & UART_ASYNC_MASK];
+	boolean address_frame = FALSE;
+	boolean block_done = FALSE;
+	uint8 data;
+
+	if ((uart_async_remaining == 0) && (async_tail != uart_async_head)
+			&& (block->position == tail)) {
+		/* The ring bytes queued before the block are sent, start the block */
+		uart_async_data = block->data;
+		uart_async_remaining = block->length;
+	}
+
+	if (uart_flow_char != 0) {
+		/* XON/XOFF go before the data, even while the peer stopped us */
+		data = uart_flow_char;
+		uart_flow_char = 0;
+	} else if (!UART_transmitAllowed()) {
+		/* Stopped by the peer, restarted by UART_checkCts or the received XON */
+		CLEAR_BIT(UCSRB, UDRIE);
+		return;
+	} else if (uart_async_remaining != 0) {
+		data = *uart_async_data;
+		uart_async_data++;
+		uart_async_remaining--;
+		block_done = (uart_async_remaining == 0);
+	} else if (tail != uart_tx_head) {
+		data = uart_tx_buffer[index];
+		if (uart_multidrop && (uart_tx_address_frames[index >> 3] & (1 << (index & 7)))) {
+			uart_tx_address_frames[index >> 3] &= ~(1 << (index & 7));
+			address_frame = TRUE;
+		}
+		uart_tx_tail = tail + 1;
+	} else {
+		/* Nothing left to send, UDRE stays set so the interrupt must be disabled */
+		CLEAR_BIT(UCSRB, UDRIE);
+		return;
+	}
+
+	if (uart_multidrop) {
+		/* UDR is empty, the previous frame already took its ninth bit */
+		if (address_frame) {
+			SET_BIT(UCSRB, TXB8);
+		} else {
+			CLEAR_BIT(UCSRB, TXB8);
+		}
+		/* Clear TXC so the TXC interrupt only comes after this frame */
+		UCSRA = (UCSRA & UART_UCSRA_SETTINGS) | (1 << TXC);
+	}
+
+	UDR = data;
+
+	if (block_done) {
+		/* Last byte of the block written, give the block back */
+		uart_async_tail = async_tail + 1;
+		if (block->callback != NULL_PTR) {
+			block->callback(block->data);
+		}
+	}
+}
+
+/**
+ * @brief release the driver enable pin once the last frame left the shift register.
+ *
+ */
+#define UART_TXC_ISR __vector_15
+
+void UART_TXC_ISR(void)__attribute__((signal, used, externally_visible));
+
+void UART_TXC_ISR(void) {
+	/* A byte queued meanwhile keeps the bus, its TXC interrupt comes later */
+	if ((uart_tx_tail == uart_tx_head) && (uart_async_tail == uart_async_head)) {
+		GPIO_clearPinAtomic(uart_de_pin);
+	}
+}
@@ -19,6 +19,177 @@
 
 #include "../../../std_types.h"
 
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/*
+ * Ring buffer sizes used by the interrupt mode (UART_initInterrupt).
+ * They must be powers of two, from 2 up to 128.
+ */
+#define UART_RX_BUFFER_SIZE 64
+#define UART_TX_BUFFER_SIZE 64
+
+/*
+ * Number of blocks that can wait for UART_sendAsync, a power of two from 2 to 128.
+ */
+#define UART_ASYNC_QUEUE_SIZE 4
+
+/*
+ * Suggested RX ring levels for UART_setFlowControl. After the stop the peer can
+ * still send the character on the wire plus its own FIFO (a few bytes for the
+ * USB-serial bridges), the room above the high watermark must hold them.
+ */
+#define UART_RX_HIGH_WATERMARK ((UART_RX_BUFFER_SIZE * 3) / 4)
+#define UART_RX_LOW_WATERMARK  (UART_RX_BUFFER_SIZE / 4)
+
+/* Software flow control characters */
+#define UART_XON  0x11
+#define UART_XOFF 0x13
+
+/*
+ * Multi-drop (RS-485) mode, see UART_initMultidrop:
+ * UART_BROADCAST_ADDRESS is accepted by every node, UART_NO_ADDRESS turns the address
+ * filter off (bus master) and UART_NO_DE_PIN is used when the transceiver has no
+ * driver enable pin (auto-direction transceivers).
+ */
+#define UART_BROADCAST_ADDRESS 0xFF
+#define UART_NO_ADDRESS        0xFE
+#define UART_NO_DE_PIN         0xFF
+
+/*
+ * Largest accepted difference between the requested and the achieved baud rate,
+ * in 0.1 % units. UART_INIT_BAUD fails the build above it and UART_solveBaud
+ * reports it. 2.0 % keeps the total error of two devices under the 8-bit frame limit.
+ */
+#define UART_BAUD_TOLERANCE 20
+
+/*
+ * Baud rate solver, the same formulas are used at compile time (constant BAUD)
+ * and at run time by UART_solveBaud:
+ * DIV = 16 for the normal speed (U2X = 0) and 8 for the double speed (U2X = 1)
+ * UBRR is rounded to the nearest value instead of truncated.
+ */
+#define UART_UBRR_FOR(BAUD, DIV) \
+	((((F_CPU) + ((DIV) * (BAUD)) / 2) / ((DIV) * (BAUD))) - 1)
+
+/* UBRR is a 12-bit register, a negative UBRR (baud rate too high) also fails */
+#define UART_UBRR_VALID(BAUD, DIV) \
+	((UART_UBRR_FOR(BAUD, DIV) + 1 != 0) && (UART_UBRR_FOR(BAUD, DIV) + 1 <= 4096))
+
+/* Achieved baud rate, rounded to the nearest integer */
+#define UART_BAUD_FOR(BAUD, DIV) \
+	(((F_CPU) + ((DIV) * (UART_UBRR_FOR(BAUD, DIV) + 1)) / 2) \
+		/ ((DIV) * (UART_UBRR_FOR(BAUD, DIV) + 1)))
+
+/* Absolute error in 0.1 % units, 0xFFFF when UBRR is out of range */
+#define UART_ERROR_FOR(BAUD, DIV) \
+	(UART_UBRR_VALID(BAUD, DIV) ? \
+		(((UART_BAUD_FOR(BAUD, DIV) > (BAUD)) ? \
+			(UART_BAUD_FOR(BAUD, DIV) - (BAUD)) : ((BAUD) - UART_BAUD_FOR(BAUD, DIV))) \
+			* 1000 / (BAUD)) : 0xFFFF)
+
+/* U2X = 0 samples each bit 16 times, it is kept unless U2X = 1 is more accurate */
+#define UART_U2X_FOR(BAUD) (UART_ERROR_FOR(BAUD, 8) < UART_ERROR_FOR(BAUD, 16))
+#define UART_DIV_FOR(BAUD) (UART_U2X_FOR(BAUD) ? 8 : 16)
+
+/* Selected setting and results for a constant baud rate */
+#define UART_UBRR(BAUD) UART_UBRR_FOR(BAUD, UART_DIV_FOR(BAUD))
+#define UART_ACHIEVED_BAUD(BAUD) UART_BAUD_FOR(BAUD, UART_DIV_FOR(BAUD))
+#define UART_BAUD_ERROR(BAUD) UART_ERROR_FOR(BAUD, UART_DIV_FOR(BAUD))
+
+/*
+ * Initialize the UART with a constant baud rate solved at compile time,
+ * the build fails when the error is above UART_BAUD_TOLERANCE:
+ *     UART_INIT_BAUD(115200UL);
+ */
+#define UART_INIT_BAUD(BAUD) \
+	do { \
+		_Static_assert(UART_BAUD_ERROR(BAUD) <= UART_BAUD_TOLERANCE, \
+				"UART baud rate error above UART_BAUD_TOLERANCE for this F_CPU"); \
+		UART_initSetting((uint16) UART_UBRR(BAUD), UART_U2X_FOR(BAUD)); \
+	} while (0)
+
+/*******************************************************************************
+ *                      Types Declaration                                      *
+ *******************************************************************************/
+
+/*
+ * Receive error counters, saturated at 0xFFFF:
+ * overrun : bytes lost by the UART hardware (DOR)
+ * framing : bytes dropped because of a missing stop bit (FE)
+ * dropped : bytes dropped because the receive ring buffer was full
+ */
+typedef struct {
+	uint16 overrun;
+	uint16 framing;
+	uint16 dropped;
+} UART_ErrorCounters;
+
+/*
+ * Called from the RXC interrupt with every valid received byte, see UART_setReceiveCallback.
+ */
+typedef void (*UartReceiveCallback)(uint8 data);
+
+/*
+ * Called from the UDRE interrupt when the last byte of a UART_sendAsync block is
+ * written to UDR, the block memory belongs to the caller again.
+ */
+typedef void (*UartSendCallback)(const uint8 *data);
+
+/*
+ * Baud rate register setting found by UART_solveBaud:
+ * ubrr          : UBRRH:UBRRL value
+ * double_speed  : U2X value
+ * achieved_baud : real baud rate of this setting
+ * error         : difference from the requested baud rate in 0.1 % units,
+ *                 0xFFFF when the baud rate is out of the UBRR range
+ */
+typedef struct {
+	uint16 ubrr;
+	boolean double_speed;
+	uint32 achieved_baud;
+	uint16 error;
+} UART_BaudSetting;
+
+/*
+ * Multi-drop bus setting used by UART_initMultidrop:
+ * address : own node address, frames sent to other addresses are filtered by the
+ *           hardware (MPCM). UART_NO_ADDRESS receives every frame.
+ * de_pin  : A0..D7 pin driving the transceiver driver enable (DE and /RE tied),
+ *           high while transmitting, or UART_NO_DE_PIN.
+ */
+typedef struct {
+	uint8 address;
+	uint8 de_pin;
+} UART_MultidropConfig;
+
+/*
+ * Flow control of the interrupt mode, see UART_setFlowControl.
+ */
+typedef enum {
+	UART_FLOW_NONE,
+	UART_FLOW_RTS_CTS, /* hardware, RTS and CTS on GPIO pins, active low */
+	UART_FLOW_XON_XOFF, /* software, UART_XOFF / UART_XON in the data stream */
+} UART_FlowControlMode;
+
+/*
+ * Flow control setting:
+ * mode           : UART_FLOW_NONE, UART_FLOW_RTS_CTS or UART_FLOW_XON_XOFF
+ * rts_pin        : A0..D7 output, low while this side accepts data (RTS_CTS only)
+ * cts_pin        : A0..D7 input, low while the peer accepts data (RTS_CTS only)
+ * high_watermark : RX ring level that stops the peer (RTS high / XOFF sent)
+ * low_watermark  : RX ring level, reached by UART_read, that lets it go on
+ *                  (RTS low / XON sent)
+ */
+typedef struct {
+	UART_FlowControlMode mode;
+	uint8 rts_pin;
+	uint8 cts_pin;
+	uint8 high_watermark;
+	uint8 low_watermark;
+} UART_FlowControlConfig;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
@@ -28,10 +199,55 @@
  * Functional responsible for Initialize the UART device by:
  * 1. Setup the Frame format like number of data bits, parity bit type and number of stop bits.
  * 2. Enable the UART.
- * 3. Setup the UART baud rate.
+ * 3. Setup the UART baud rate, UBRR and U2X are chosen by UART_solveBaud.
+ * 4. Leave the interrupt and multi-drop modes of an earlier init, the API polls.
  */
 void UART_init(uint32 baud_rate);
 
+/*
+ * Description :
+ * Initialize the UART like UART_init with an already solved baud rate setting,
+ * used by UART_INIT_BAUD.
+ */
+void UART_initSetting(uint16 ubrr_value, boolean double_speed);
+
+/*
+ * Description :
+ * Find the UBRR and U2X values with the smallest error for baud_rate at F_CPU.
+ * Return TRUE if the error is within UART_BAUD_TOLERANCE, FALSE for a zero baud rate.
+ */
+boolean UART_solveBaud(uint32 baud_rate, UART_BaudSetting *setting);
+
+/*
+ * Description :
+ * Return the achieved baud rate of the current UART setting.
+ */
+uint32 UART_getBaudRate(void);
+
+/*
+ * Description :
+ * Change UBRR and U2X to the setting without changing the frame format or the mode,
+ * used by HAL/Auto_Baud.
+ */
+void UART_setBaudSetting(const UART_BaudSetting *setting);
+
+/*
+ * Description :
+ * Enable or disable the receiver, disabling it flushes the received bytes still
+ * in the UART (not the RX ring buffer).
+ */
+void UART_enableReceiver(boolean enable);
+
+/*
+ * Description :
+ * Initialize the UART like UART_init, then switch it to the interrupt mode:
+ * received bytes are stored in a ring buffer by the RXC interrupt and the bytes
+ * to send are taken from a ring buffer by the UDRE interrupt.
+ * The global interrupts must be enabled by the application.
+ * All the functions of this module keep working in the interrupt mode.
+ */
+void UART_initInterrupt(uint32 baud_rate);
+
 /*
  * Description :
  * Functional responsible for send byte to another UART device.
@@ -53,7 +269,100 @@ void UART_sendString(const uint8 *Str);
 /*
  * Description :
  * Receive the required string until the '#' symbol through UART from the other UART device.
+ * It blocks until the '#' and does not check the buffer size, HAL/Line_Assembler
+ * is the bounded, non-blocking replacement.
  */
 void UART_receiveString(uint8 *Str); // Receive until #
 
+/*
+ * Description :
+ * Non-blocking send, queue as many bytes as possible and return their number.
+ * Without the interrupt mode the bytes are written while the UART is free (UDRE).
+ */
+uint16 UART_write(const uint8 *data, uint16 length);
+
+/*
+ * Description :
+ * Non-blocking receive, copy up to max_length received bytes and return their number.
+ */
+uint16 UART_read(uint8 *data, uint16 max_length);
+
+/*
+ * Description :
+ * Copy the receive error counters, then clear them if clear is TRUE.
+ */
+void UART_getErrorCounters(UART_ErrorCounters *counters, boolean clear);
+
+/*
+ * Description :
+ * In the interrupt mode, pass every received byte to callback from the RXC ISR
+ * instead of storing it in the RX ring buffer. NULL_PTR goes back to the ring.
+ */
+void UART_setReceiveCallback(UartReceiveCallback callback);
+
+/*
+ * Description :
+ * Enable flow control, call it after UART_initInterrupt (which turns it off).
+ * 1. The RXC ISR stops the peer when the RX ring reaches high_watermark and
+ *    UART_read lets it go on when the ring is back to low_watermark.
+ * 2. The UDRE ISR stops sending while CTS is high (RTS_CTS) or after a UART_XOFF
+ *    was received, up to a UART_XON (XON_XOFF). The received UART_XON/UART_XOFF are
+ *    not stored, the sent ones go before the queued data.
+ * The bytes passed to the receive callback are not counted in the ring level.
+ */
+void UART_setFlowControl(const UART_FlowControlConfig *config);
+
+/*
+ * Description :
+ * Restart the transmission stopped by CTS high, call it from the main loop or from
+ * an EXTI callback when CTS is on INT0/INT1 (any change sense).
+ */
+void UART_checkCts(void);
+
+/*
+ * Description :
+ * Zero-copy send in the interrupt mode: queue a block, the UDRE ISR writes its bytes
+ * directly from data to UDR and then calls callback (may be NULL_PTR). The block must
+ * stay unchanged until then. The blocks and the bytes of UART_write/UART_sendByte are
+ * sent in the order they are queued.
+ * Return FALSE if the UART is not in the interrupt mode, length is 0 or
+ * UART_ASYNC_QUEUE_SIZE blocks are already waiting.
+ */
+boolean UART_sendAsync(const uint8 *data, uint16 length, UartSendCallback callback);
+
+/*
+ * Description :
+ * Return the number of UART_sendAsync blocks not completely written yet.
+ */
+uint8 UART_getPendingBlocks(void);
+
+/*
+ * Description :
+ * Initialize the UART like UART_initInterrupt with 9-bit frames for a multi-drop bus:
+ * 1. The ninth bit (TXB8/RXB8) is 1 for the address frames and 0 for the data frames.
+ * 2. With an own address, the multi-processor mode (MPCM) is set so the receiver drops
+ *    the data frames in hardware. An address frame with the own address or
+ *    UART_BROADCAST_ADDRESS clears MPCM and the following data frames are received
+ *    until an address frame for another node, then MPCM is set again. No RXC interrupt
+ *    is taken for the frames sent to other nodes.
+ * 3. The driver enable pin is set before the first byte is queued and cleared from the
+ *    TXC interrupt once the last stop bit is on the bus.
+ * The address frames are not stored in the RX ring buffer.
+ */
+void UART_initMultidrop(uint32 baud_rate, const UART_MultidropConfig *config);
+
+/*
+ * Description :
+ * Queue an address frame (ninth bit = 1) selecting the node for the following data,
+ * waits for a free place in the TX ring. Only used in the multi-drop mode.
+ */
+void UART_sendAddress(uint8 address);
+
+/*
+ * Description :
+ * Change the own address of the multi-drop mode, the receiver waits for the next
+ * address frame.
+ */
+void UART_setMultidropAddress(uint8 address);
+
 #endif /* UART_H_ */
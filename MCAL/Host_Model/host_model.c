@@ -0,0 +1,1089 @@
+/**
+ * @file host_model.c
+ * @brief Source file for the host register model.
+ * @version 1.0
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ *
+ * @details
+ * This source file contains the simulated ATmega32 I/O space used by HOST_BUILD:
+ * the lazy detection of the register writes, the behavioral models of the
+ * peripherals, the interrupt dispatch to the driver ISRs and the access counters.
+ * See host_model.h for the list of the simulated behaviors and their limitations.
+ */
+
+#include "host_model.h"
+
+/* Only the bit names are used here, the register macros are not used by the model */
+#include "../Atmega32_Registers.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* Data-space addresses of the registers */
+#define A_TWBR   0x20
+#define A_TWSR   0x21
+#define A_TWAR   0x22
+#define A_TWDR   0x23
+#define A_UBRRL  0x29
+#define A_UCSRB  0x2A
+#define A_UCSRA  0x2B
+#define A_UDR    0x2C
+#define A_SPCR   0x2D
+#define A_SPSR   0x2E
+#define A_SPDR   0x2F
+#define A_PIND   0x30
+#define A_PORTA  0x3B
+#define A_UBRRH  0x40
+#define A_ICR1   0x46
+#define A_OCR1B  0x48
+#define A_OCR1A  0x4A
+#define A_TCNT1  0x4C
+#define A_TCCR1B 0x4E
+#define A_TCCR1A 0x4F
+#define A_TCNT0  0x52
+#define A_TCCR0  0x53
+#define A_MCUCSR 0x54
+#define A_MCUCR  0x55
+#define A_TWCR   0x56
+#define A_TIFR   0x58
+#define A_TIMSK  0x59
+#define A_GIFR   0x5A
+#define A_GICR   0x5B
+#define A_OCR0   0x5C
+#define A_SP     0x5D
+#define A_SREG   0x5F
+
+#define HOST_IO_FIRST 0x20
+#define HOST_IO_SIZE  0x60
+
+/* Longest time step between two interrupt checks */
+#define HOST_MAX_STEP_CYCLES 64
+
+/* Unused register bits kept set by the model so every driver write differs */
+#define TWCR_MODEL_BIT 1
+#define GIFR_MODEL_BIT 0
+
+/* Bits of the registers not listed in Atmega32_Registers.h */
+#define TOV0   0
+#define OCF0   1
+#define TOV1   2
+#define OCF1B  3
+#define OCF1A  4
+#define ICF1   5
+#define WGM01  3
+#define WGM00  6
+#define WGM12  3
+#define ICES1  6
+
+#define HOST_UART_RX_QUEUE_SIZE 1024
+#define HOST_UART_TX_LOG_SIZE   4096
+
+/* TWSR status codes */
+#define TW_START         0x08
+#define TW_REP_START     0x10
+#define TW_MT_SLA_ACK    0x18
+#define TW_MT_SLA_NACK   0x20
+#define TW_MT_DATA_ACK   0x28
+#define TW_MT_DATA_NACK  0x30
+#define TW_MR_SLA_ACK    0x40
+#define TW_MR_SLA_NACK   0x48
+#define TW_MR_DATA_ACK   0x50
+#define TW_MR_DATA_NACK  0x58
+#define TW_NO_INFO       0xF8
+#define TW_SR_SLA_ACK    0x60
+#define TW_SR_GCALL_ACK  0x70
+#define TW_SR_DATA_ACK   0x80
+#define TW_SR_DATA_NACK  0x88
+#define TW_SR_GCALL_DATA_ACK  0x90
+#define TW_SR_GCALL_DATA_NACK 0x98
+#define TW_SR_STOP       0xA0
+#define TW_ST_SLA_ACK    0xA8
+#define TW_ST_DATA_ACK   0xB8
+#define TW_ST_DATA_NACK  0xC0
+#define TW_ST_LAST_DATA  0xC8
+
+/*******************************************************************************
+ *                      Types Declaration                                      *
+ *******************************************************************************/
+
+typedef struct {
+	uint16 data; /* bit 8 is the ninth data bit / the MPCM address bit */
+	uint8 error_flags; /* (1 << FE) | (1 << DOR) | (1 << PE) */
+} HOST_UartFrame;
+
+/*******************************************************************************
+ *                      Model State                                            *
+ *******************************************************************************/
+
+static uint8 HOST_io[HOST_IO_SIZE] __attribute__((aligned(2)));
+static uint8 HOST_shadow[HOST_IO_SIZE];
+static boolean HOST_accessed[HOST_IO_SIZE];
+static uint32 HOST_accessCount[HOST_IO_SIZE];
+static uint32 HOST_totalAccessCount;
+static uint64 HOST_cycles;
+static boolean HOST_inIsr;
+static boolean HOST_initialized;
+
+/* GPIO */
+static uint8 HOST_pinLevel[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+/* Timers */
+static uint32 HOST_timer0Prescale;
+static uint32 HOST_timer1Prescale;
+
+/* UART */
+static uint8 HOST_ucsrc = (1 << URSEL) | (1 << UCSZ1) | (1 << UCSZ0);
+static uint8 HOST_ubrrh;
+static HOST_UartFrame HOST_uartRxQueue[HOST_UART_RX_QUEUE_SIZE];
+static uint16 HOST_uartRxHead, HOST_uartRxCount;
+static sint32 HOST_uartRxRemaining;
+static HOST_UartFrame HOST_uartRxFifo[2];
+static uint8 HOST_uartRxFifoCount;
+static boolean HOST_uartRxPendingAtAccess;
+static uint16 HOST_uartTxLog[HOST_UART_TX_LOG_SIZE];
+static uint16 HOST_uartTxLogHead, HOST_uartTxLogCount;
+static boolean HOST_uartTxBufferFull, HOST_uartTxShiftBusy;
+static uint16 HOST_uartTxBuffer, HOST_uartTxShift;
+static sint32 HOST_uartTxRemaining;
+
+/* SPI */
+static HOST_SpiPeer HOST_spiPeer = NULL_PTR;
+static boolean HOST_spiBusy, HOST_spiArmed, HOST_spiPendingAtAccess;
+/* A received byte not read yet, SPIF alone is cleared by the SPI ISR entry */
+static boolean HOST_spiRxUnread;
+static sint32 HOST_spiRemaining;
+static uint8 HOST_spiTx, HOST_spiRx;
+
+/* TWI */
+static const HOST_TwiSlave *HOST_twiSlaves[HOST_TWI_MAX_SLAVES];
+static const HOST_TwiSlave *HOST_twiActive;
+static boolean HOST_twiOwnsBus, HOST_twiBusy, HOST_twiStopPending, HOST_twiReading;
+static sint32 HOST_twiRemaining;
+static uint8 HOST_twiResultStatus, HOST_twiResultData;
+/* This MCU addressed as a slave by the external master of the HOST_twiMaster calls */
+static boolean HOST_twiSlaveActive, HOST_twiSlaveReading, HOST_twiSlaveGeneralCall;
+/* TWEA and TWDR when the driver last cleared TWINT */
+static boolean HOST_twiLastAck;
+static uint8 HOST_twiLastData;
+
+/* Interrupt vectors of the drivers, the missing ones resolve to NULL */
+#define HOST_VECTOR(N) extern void __vector_##N(void) __attribute__((weak));
+HOST_VECTOR(1) HOST_VECTOR(2) HOST_VECTOR(3) HOST_VECTOR(6) HOST_VECTOR(7)
+HOST_VECTOR(8) HOST_VECTOR(9) HOST_VECTOR(10) HOST_VECTOR(11) HOST_VECTOR(12)
+HOST_VECTOR(13) HOST_VECTOR(14) HOST_VECTOR(15) HOST_VECTOR(19)
+
+/*******************************************************************************
+ *                      Register File Helpers                                  *
+ *******************************************************************************/
+
+/* Model side write, not seen as a driver write */
+static void HOST_set(uint8 address, uint8 value) {
+	HOST_io[address] = value;
+	HOST_shadow[address] = value;
+}
+
+static void HOST_setBit(uint8 address, uint8 bit) {
+	HOST_set(address, HOST_io[address] | (1 << bit));
+}
+
+static void HOST_clearBit(uint8 address, uint8 bit) {
+	HOST_set(address, HOST_io[address] & ~(1 << bit));
+}
+
+static boolean HOST_bit(uint8 address, uint8 bit) {
+	return (HOST_io[address] >> bit) & 1;
+}
+
+static uint16 HOST_get16(uint8 address) {
+	return HOST_io[address] | (HOST_io[address + 1] << 8);
+}
+
+static void HOST_set16(uint8 address, uint16 value) {
+	HOST_set(address, value & 0xFF);
+	HOST_set(address + 1, value >> 8);
+}
+
+/*******************************************************************************
+ *                      GPIO / EXTI                                            *
+ *******************************************************************************/
+
+/* PINx follows PORTx on the outputs and the external level on the inputs */
+static void HOST_updatePins(void) {
+	uint8 port_num;
+	uint8 port_address;
+
+	for (port_num = 0; port_num < 4; port_num++) {
+		port_address = A_PORTA - (3 * port_num);
+		HOST_set(port_address - 2,
+				(HOST_io[port_address] & HOST_io[port_address - 1])
+						| (HOST_pinLevel[port_num] & ~HOST_io[port_address - 1]));
+	}
+}
+
+/* Set the flag of an edge sensed line, sense is the ISCx1:0 value */
+static void HOST_senseEdge(uint8 sense, boolean old_level, boolean new_level,
+		uint8 flag) {
+	if ((sense == 1 && old_level != new_level)
+			|| (sense == 2 && old_level && !new_level)
+			|| (sense == 3 && !old_level && new_level)) {
+		HOST_setBit(A_GIFR, flag);
+	}
+}
+
+static void HOST_pinsChanged(uint8 old_pind, uint8 old_pinb) {
+	uint8 new_pind = HOST_io[A_PIND];
+	uint8 new_pinb = HOST_io[A_PIND + 6];
+	uint16 tcnt1;
+
+	HOST_senseEdge(HOST_io[A_MCUCR] & 3, (old_pind >> 2) & 1,
+			(new_pind >> 2) & 1, INTF0);
+	HOST_senseEdge((HOST_io[A_MCUCR] >> 2) & 3, (old_pind >> 3) & 1,
+			(new_pind >> 3) & 1, INTF1);
+	HOST_senseEdge(HOST_bit(A_MCUCSR, ISC2) ? 3 : 2, (old_pinb >> 2) & 1,
+			(new_pinb >> 2) & 1, INTF2);
+
+	/* Timer1 input capture on ICP1 (D6) */
+	if (((old_pind ^ new_pind) >> 6) & 1) {
+		if (((new_pind >> 6) & 1) == HOST_bit(A_TCCR1B, ICES1)) {
+			tcnt1 = HOST_get16(A_TCNT1);
+			HOST_set16(A_ICR1, tcnt1);
+			HOST_setBit(A_TIFR, ICF1);
+		}
+	}
+}
+
+void HOST_setPin(uint8 pin_num, uint8 level) {
+	uint8 old_pind, old_pinb;
+
+	if (pin_num > 31) {
+		return;
+	}
+	HOST_sync();
+	old_pind = HOST_io[A_PIND];
+	old_pinb = HOST_io[A_PIND + 6];
+	if (level) {
+		HOST_pinLevel[pin_num / 8] |= (1 << (pin_num % 8));
+	} else {
+		HOST_pinLevel[pin_num / 8] &= ~(1 << (pin_num % 8));
+	}
+	HOST_updatePins();
+	HOST_pinsChanged(old_pind, old_pinb);
+}
+
+/*******************************************************************************
+ *                      Timers                                                 *
+ *******************************************************************************/
+
+static const uint16 HOST_prescalers[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+static void HOST_timer0Tick(void) {
+	uint8 tcnt = HOST_io[A_TCNT0];
+	boolean ctc = HOST_bit(A_TCCR0, WGM01) && !HOST_bit(A_TCCR0, WGM00);
+
+	if (tcnt == HOST_io[A_OCR0]) {
+		HOST_setBit(A_TIFR, OCF0);
+		if (ctc) {
+			HOST_set(A_TCNT0, 0);
+			return;
+		}
+	}
+	tcnt++;
+	if (tcnt == 0) {
+		HOST_setBit(A_TIFR, TOV0);
+	}
+	HOST_set(A_TCNT0, tcnt);
+}
+
+static void HOST_timer1Tick(void) {
+	uint16 tcnt = HOST_get16(A_TCNT1);
+	boolean ctc = HOST_bit(A_TCCR1B, WGM12);
+
+	if (tcnt == HOST_get16(A_OCR1B)) {
+		HOST_setBit(A_TIFR, OCF1B);
+	}
+	if (tcnt == HOST_get16(A_OCR1A)) {
+		HOST_setBit(A_TIFR, OCF1A);
+		if (ctc) {
+			HOST_set16(A_TCNT1, 0);
+			return;
+		}
+	}
+	tcnt++;
+	if (tcnt == 0) {
+		HOST_setBit(A_TIFR, TOV1);
+	}
+	HOST_set16(A_TCNT1, tcnt);
+}
+
+static void HOST_timersStep(uint32 cycles) {
+	uint16 prescaler;
+
+	prescaler = HOST_prescalers[HOST_io[A_TCCR0] & 7];
+	if (prescaler != 0) {
+		HOST_timer0Prescale += cycles;
+		while (HOST_timer0Prescale >= prescaler) {
+			HOST_timer0Prescale -= prescaler;
+			HOST_timer0Tick();
+		}
+	}
+	prescaler = HOST_prescalers[HOST_io[A_TCCR1B] & 7];
+	if (prescaler != 0) {
+		HOST_timer1Prescale += cycles;
+		while (HOST_timer1Prescale >= prescaler) {
+			HOST_timer1Prescale -= prescaler;
+			HOST_timer1Tick();
+		}
+	}
+}
+
+/*******************************************************************************
+ *                      UART                                                   *
+ *******************************************************************************/
+
+static uint8 HOST_uartDataBits(void) {
+	uint8 size = ((HOST_ucsrc >> UCSZ0) & 3) | (HOST_bit(A_UCSRB, UCSZ2) << 2);
+
+	return (size == 7) ? 9 : (5 + (size & 3));
+}
+
+static sint32 HOST_uartFrameCycles(void) {
+	uint16 ubrr = ((HOST_ubrrh & 0x0F) << 8) | HOST_io[A_UBRRL];
+	uint8 bits = 1 + HOST_uartDataBits() + (((HOST_ucsrc >> UPM1) & 1) ? 1 : 0)
+			+ (((HOST_ucsrc >> USBS) & 1) ? 2 : 1);
+
+	return (sint32) (ubrr + 1) * (HOST_bit(A_UCSRA, U2X) ? 8 : 16) * bits;
+}
+
+/* Show the head of the RX FIFO in UCSRA/UCSRB */
+static void HOST_uartShowRx(void) {
+	uint8 ucsra = HOST_io[A_UCSRA]
+			& ~((1 << RXC) | (1 << FE) | (1 << DOR) | (1 << PE));
+
+	if (HOST_uartRxFifoCount > 0) {
+		ucsra |= (1 << RXC) | HOST_uartRxFifo[0].error_flags;
+		if (HOST_uartRxFifo[0].data & 0x100) {
+			HOST_setBit(A_UCSRB, RXB8);
+		} else {
+			HOST_clearBit(A_UCSRB, RXB8);
+		}
+	}
+	HOST_set(A_UCSRA, ucsra);
+}
+
+static void HOST_uartReceive(HOST_UartFrame frame) {
+	/* In MPCM mode the frames without the address bit are dropped by the receiver */
+	if (HOST_bit(A_UCSRA, MPCM) && !(frame.data & 0x100)) {
+		return;
+	}
+	if (HOST_uartRxFifoCount < 2) {
+		HOST_uartRxFifo[HOST_uartRxFifoCount++] = frame;
+	} else {
+		HOST_uartRxFifo[1].error_flags |= (1 << DOR);
+	}
+	HOST_uartShowRx();
+}
+
+static void HOST_uartPop(void) {
+	if (HOST_uartRxFifoCount > 0) {
+		HOST_uartRxFifo[0] = HOST_uartRxFifo[1];
+		HOST_uartRxFifoCount--;
+	}
+	HOST_uartShowRx();
+}
+
+static void HOST_uartWrite(uint8 data) {
+	if (!HOST_bit(A_UCSRB, TXEN) || HOST_uartTxBufferFull) {
+		return;
+	}
+	HOST_uartTxBuffer = data | (HOST_bit(A_UCSRB, TXB8) << 8);
+	HOST_uartTxBufferFull = TRUE;
+	HOST_clearBit(A_UCSRA, UDRE);
+	HOST_clearBit(A_UCSRA, TXC);
+}
+
+static void HOST_uartStep(uint32 cycles) {
+	/* Transmitter */
+	if (HOST_uartTxShiftBusy) {
+		HOST_uartTxRemaining -= cycles;
+		if (HOST_uartTxRemaining <= 0) {
+			HOST_uartTxShiftBusy = FALSE;
+			HOST_uartTxLog[(HOST_uartTxLogHead + HOST_uartTxLogCount)
+					% HOST_UART_TX_LOG_SIZE] = HOST_uartTxShift;
+			if (HOST_uartTxLogCount < HOST_UART_TX_LOG_SIZE) {
+				HOST_uartTxLogCount++;
+			} else {
+				HOST_uartTxLogHead = (HOST_uartTxLogHead + 1)
+						% HOST_UART_TX_LOG_SIZE;
+			}
+			if (!HOST_uartTxBufferFull) {
+				HOST_setBit(A_UCSRA, TXC);
+			}
+		}
+	}
+	if (!HOST_uartTxShiftBusy && HOST_uartTxBufferFull) {
+		HOST_uartTxShift = HOST_uartTxBuffer;
+		HOST_uartTxBufferFull = FALSE;
+		HOST_uartTxShiftBusy = TRUE;
+		HOST_uartTxRemaining = HOST_uartFrameCycles();
+		HOST_setBit(A_UCSRA, UDRE);
+	}
+
+	/* Receiver */
+	if (HOST_uartRxCount > 0 && HOST_bit(A_UCSRB, RXEN)) {
+		HOST_uartRxRemaining -= cycles;
+		if (HOST_uartRxRemaining <= 0) {
+			HOST_uartReceive(HOST_uartRxQueue[HOST_uartRxHead]);
+			HOST_uartRxHead = (HOST_uartRxHead + 1) % HOST_UART_RX_QUEUE_SIZE;
+			HOST_uartRxCount--;
+			HOST_uartRxRemaining += HOST_uartFrameCycles();
+		}
+	}
+}
+
+void HOST_uartInjectFrame(uint16 data, uint8 error_flags) {
+	HOST_sync();
+	if (HOST_uartRxCount == HOST_UART_RX_QUEUE_SIZE) {
+		return;
+	}
+	if (HOST_uartRxCount == 0) {
+		HOST_uartRxRemaining = HOST_uartFrameCycles();
+	}
+	HOST_uartRxQueue[(HOST_uartRxHead + HOST_uartRxCount)
+			% HOST_UART_RX_QUEUE_SIZE].data = data;
+	HOST_uartRxQueue[(HOST_uartRxHead + HOST_uartRxCount)
+			% HOST_UART_RX_QUEUE_SIZE].error_flags = error_flags;
+	HOST_uartRxCount++;
+}
+
+void HOST_uartInject(const uint8 *data, uint16 length) {
+	uint16 i;
+
+	for (i = 0; i < length; i++) {
+		/* Plain bytes have the stop bit / address bit set like an idle line */
+		HOST_uartInjectFrame(data[i] | 0x100, 0);
+	}
+}
+
+uint16 HOST_uartTakeFrames(uint16 *frames, uint16 max_length) {
+	uint16 count = 0;
+
+	HOST_sync();
+	while (count < max_length && HOST_uartTxLogCount > 0) {
+		frames[count++] = HOST_uartTxLog[HOST_uartTxLogHead];
+		HOST_uartTxLogHead = (HOST_uartTxLogHead + 1) % HOST_UART_TX_LOG_SIZE;
+		HOST_uartTxLogCount--;
+	}
+	return count;
+}
+
+uint16 HOST_uartTake(uint8 *data, uint16 max_length) {
+	uint16 count = 0;
+
+	HOST_sync();
+	while (count < max_length && HOST_uartTxLogCount > 0) {
+		data[count++] = (uint8) HOST_uartTxLog[HOST_uartTxLogHead];
+		HOST_uartTxLogHead = (HOST_uartTxLogHead + 1) % HOST_UART_TX_LOG_SIZE;
+		HOST_uartTxLogCount--;
+	}
+	return count;
+}
+
+/*******************************************************************************
+ *                      SPI                                                    *
+ *******************************************************************************/
+
+static sint32 HOST_spiByteCycles(void) {
+	static const uint8 dividers[4] = { 4, 16, 64, 128 };
+	sint32 divider = dividers[HOST_io[A_SPCR] & 3];
+
+	if (HOST_bit(A_SPSR, SPI2X)) {
+		divider /= 2;
+	}
+	return 8 * divider;
+}
+
+static void HOST_spiWrite(uint8 data) {
+	if (HOST_spiBusy) {
+		HOST_setBit(A_SPSR, WCOL);
+		return;
+	}
+	HOST_spiTx = data;
+	HOST_spiRxUnread = FALSE;
+	if (HOST_bit(A_SPCR, SPE) && HOST_bit(A_SPCR, MSTR)) {
+		HOST_spiBusy = TRUE;
+		HOST_spiRemaining = HOST_spiByteCycles();
+	}
+}
+
+static void HOST_spiStep(uint32 cycles) {
+	if (HOST_spiBusy) {
+		HOST_spiRemaining -= cycles;
+		if (HOST_spiRemaining <= 0) {
+			HOST_spiBusy = FALSE;
+			HOST_spiRx = (HOST_spiPeer != NULL_PTR) ?
+					HOST_spiPeer(HOST_spiTx) : 0xFF;
+			HOST_spiRxUnread = TRUE;
+			HOST_setBit(A_SPSR, SPIF);
+		}
+	}
+}
+
+void HOST_spiSetPeer(HOST_SpiPeer peer) {
+	HOST_spiPeer = peer;
+}
+
+uint8 HOST_spiMasterTransfer(uint8 mosi) {
+	uint8 miso;
+
+	HOST_sync();
+	if (!HOST_bit(A_SPCR, SPE) || HOST_bit(A_SPCR, MSTR)) {
+		return 0xFF;
+	}
+	miso = HOST_spiTx;
+	HOST_spiRx = mosi;
+	HOST_spiRxUnread = TRUE;
+	HOST_setBit(A_SPSR, SPIF);
+	HOST_advanceCycles(16);
+	return miso;
+}
+
+/*******************************************************************************
+ *                      TWI                                                    *
+ *******************************************************************************/
+
+static sint32 HOST_twiBitCycles(void) {
+	return 16 + 2 * (sint32) HOST_io[A_TWBR] * (1 << (2 * (HOST_io[A_TWSR] & 3)));
+}
+
+static const HOST_TwiSlave* HOST_twiFind(uint8 address) {
+	uint8 i;
+
+	for (i = 0; i < HOST_TWI_MAX_SLAVES; i++) {
+		if (HOST_twiSlaves[i] != NULL_PTR && HOST_twiSlaves[i]->address == address) {
+			return HOST_twiSlaves[i];
+		}
+	}
+	return NULL_PTR;
+}
+
+static void HOST_twiEndTransaction(void) {
+	if (HOST_twiActive != NULL_PTR && HOST_twiActive->stop != NULL_PTR) {
+		HOST_twiActive->stop();
+	}
+	HOST_twiActive = NULL_PTR;
+}
+
+/* TWCR written with TWINT = 1, start the requested bus operation */
+static void HOST_twiCommand(uint8 twcr) {
+	uint8 status = HOST_io[A_TWSR] & 0xF8;
+	uint8 data = HOST_io[A_TWDR];
+	boolean ack;
+
+	HOST_twiLastAck = (twcr & (1 << TWEA)) != 0;
+	HOST_twiLastData = data;
+	HOST_twiResultData = data;
+	if (twcr & (1 << TWSTA)) {
+		HOST_twiEndTransaction();
+		HOST_twiResultStatus = HOST_twiOwnsBus ? TW_REP_START : TW_START;
+		HOST_twiOwnsBus = TRUE;
+		HOST_twiRemaining = 2 * HOST_twiBitCycles();
+		if (HOST_twiStopPending) {
+			/* START requested while the STOP is still on the bus, sent after it */
+			HOST_twiStopPending = FALSE;
+			HOST_twiRemaining += HOST_twiBitCycles();
+		}
+	} else if (twcr & (1 << TWSTO)) {
+		HOST_twiEndTransaction();
+		HOST_twiOwnsBus = FALSE;
+		HOST_twiStopPending = TRUE;
+		HOST_twiRemaining = HOST_twiBitCycles();
+	} else if (!HOST_twiOwnsBus) {
+		return;
+	} else if (status == TW_START || status == TW_REP_START) {
+		/* SLA+R/W */
+		HOST_twiReading = data & 1;
+		HOST_twiActive = HOST_twiFind(data >> 1);
+		ack = (HOST_twiActive != NULL_PTR)
+				&& (HOST_twiActive->start == NULL_PTR
+						|| HOST_twiActive->start(HOST_twiReading));
+		if (!ack) {
+			HOST_twiActive = NULL_PTR;
+		}
+		if (HOST_twiReading) {
+			HOST_twiResultStatus = ack ? TW_MR_SLA_ACK : TW_MR_SLA_NACK;
+		} else {
+			HOST_twiResultStatus = ack ? TW_MT_SLA_ACK : TW_MT_SLA_NACK;
+		}
+		HOST_twiRemaining = 9 * HOST_twiBitCycles();
+	} else if (HOST_twiReading) {
+		/* Master receive, ACK the byte if TWEA is set */
+		HOST_twiResultData = 0xFF;
+		if (HOST_twiActive != NULL_PTR && HOST_twiActive->read != NULL_PTR) {
+			HOST_twiResultData = HOST_twiActive->read();
+		}
+		HOST_twiResultStatus =
+				(twcr & (1 << TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK;
+		HOST_twiRemaining = 9 * HOST_twiBitCycles();
+	} else {
+		/* Master transmit */
+		ack = (HOST_twiActive != NULL_PTR)
+				&& (HOST_twiActive->write == NULL_PTR
+						|| HOST_twiActive->write(data));
+		HOST_twiResultStatus = ack ? TW_MT_DATA_ACK : TW_MT_DATA_NACK;
+		HOST_twiRemaining = 9 * HOST_twiBitCycles();
+	}
+	HOST_twiBusy = TRUE;
+}
+
+static void HOST_twiStep(uint32 cycles) {
+	if (!HOST_twiBusy) {
+		return;
+	}
+	HOST_twiRemaining -= cycles;
+	if (HOST_twiRemaining > 0) {
+		return;
+	}
+	HOST_twiBusy = FALSE;
+	if (HOST_twiStopPending) {
+		/* STOP sent, TWSTO is cleared and TWINT is not set */
+		HOST_twiStopPending = FALSE;
+		HOST_clearBit(A_TWCR, TWSTO);
+		HOST_set(A_TWSR, TW_NO_INFO | (HOST_io[A_TWSR] & 3));
+		return;
+	}
+	HOST_set(A_TWDR, HOST_twiResultData);
+	HOST_set(A_TWSR, HOST_twiResultStatus | (HOST_io[A_TWSR] & 3));
+	HOST_set(A_TWCR, HOST_io[A_TWCR] | (1 << TWINT) | (1 << TWCR_MODEL_BIT));
+}
+
+/* Give the slave driver a TWINT with status, wait for its ISR to clear TWINT */
+static void HOST_twiSlaveEvent(uint8 status, uint8 data) {
+	uint16 i;
+
+	HOST_set(A_TWDR, data);
+	HOST_set(A_TWSR, status | (HOST_io[A_TWSR] & 3));
+	HOST_set(A_TWCR, HOST_io[A_TWCR] | (1 << TWINT) | (1 << TWCR_MODEL_BIT));
+	for (i = 0; (i < 1000) && HOST_bit(A_TWCR, TWINT); i++) {
+		HOST_advanceCycles(HOST_twiBitCycles());
+	}
+}
+
+boolean HOST_twiMasterStart(uint8 sla_rw) {
+	uint8 address = sla_rw >> 1;
+	boolean reading = sla_rw & 1;
+	boolean general_call = (address == 0);
+
+	HOST_sync();
+	if (!HOST_bit(A_TWCR, TWEN) || !HOST_bit(A_TWCR, TWEA) || HOST_twiOwnsBus) {
+		return FALSE;
+	}
+	if (general_call ? (reading || !HOST_bit(A_TWAR, TWGCE))
+			: (address != (HOST_io[A_TWAR] >> 1))) {
+		return FALSE;
+	}
+	if (HOST_twiSlaveActive && !HOST_twiSlaveReading) {
+		/* Repeated START ends the write */
+		HOST_twiSlaveEvent(TW_SR_STOP, HOST_io[A_TWDR]);
+	}
+	HOST_twiSlaveActive = TRUE;
+	HOST_twiSlaveReading = reading;
+	HOST_twiSlaveGeneralCall = general_call;
+	HOST_twiSlaveEvent(reading ? TW_ST_SLA_ACK :
+			general_call ? TW_SR_GCALL_ACK : TW_SR_SLA_ACK, sla_rw);
+	return TRUE;
+}
+
+boolean HOST_twiMasterWrite(uint8 data) {
+	boolean ack;
+
+	HOST_sync();
+	if (!HOST_twiSlaveActive || HOST_twiSlaveReading) {
+		return FALSE;
+	}
+	ack = HOST_twiLastAck;
+	if (HOST_twiSlaveGeneralCall) {
+		HOST_twiSlaveEvent(ack ? TW_SR_GCALL_DATA_ACK : TW_SR_GCALL_DATA_NACK, data);
+	} else {
+		HOST_twiSlaveEvent(ack ? TW_SR_DATA_ACK : TW_SR_DATA_NACK, data);
+	}
+	return ack;
+}
+
+uint8 HOST_twiMasterRead(boolean ack) {
+	uint8 data;
+	uint8 status;
+
+	HOST_sync();
+	if (!HOST_twiSlaveActive || !HOST_twiSlaveReading) {
+		return 0xFF;
+	}
+	data = HOST_twiLastData;
+	status = !ack ? TW_ST_DATA_NACK : HOST_twiLastAck ? TW_ST_DATA_ACK : TW_ST_LAST_DATA;
+	if (status != TW_ST_DATA_ACK) {
+		/* The slave is not addressed any more, the master sends the STOP */
+		HOST_twiSlaveActive = FALSE;
+	}
+	HOST_twiSlaveEvent(status, data);
+	return data;
+}
+
+void HOST_twiMasterStop(void) {
+	HOST_sync();
+	if (HOST_twiSlaveActive && !HOST_twiSlaveReading) {
+		HOST_twiSlaveEvent(TW_SR_STOP, HOST_io[A_TWDR]);
+	}
+	HOST_twiSlaveActive = FALSE;
+}
+
+void HOST_twiAttachSlave(const HOST_TwiSlave *slave) {
+	uint8 i;
+
+	for (i = 0; i < HOST_TWI_MAX_SLAVES; i++) {
+		if (HOST_twiSlaves[i] == NULL_PTR) {
+			HOST_twiSlaves[i] = slave;
+			return;
+		}
+	}
+}
+
+/*******************************************************************************
+ *                      Interrupts                                             *
+ *******************************************************************************/
+
+static void HOST_call(void (*vector)(void)) {
+	HOST_clearBit(A_SREG, I_BIT);
+	HOST_inIsr = TRUE;
+	vector();
+	HOST_sync();
+	HOST_inIsr = FALSE;
+	HOST_setBit(A_SREG, I_BIT);
+}
+
+/* Call the highest priority pending ISR, flag cleared like the hardware does */
+static void HOST_dispatchInterrupts(void) {
+	if (HOST_inIsr || !HOST_bit(A_SREG, I_BIT)) {
+		return;
+	}
+	if (__vector_1 && HOST_bit(A_GICR, INT0)
+			&& (HOST_bit(A_GIFR, INTF0)
+					|| ((HOST_io[A_MCUCR] & 3) == 0 && !HOST_bit(A_PIND, 2)))) {
+		HOST_clearBit(A_GIFR, INTF0);
+		HOST_call(__vector_1);
+	} else if (__vector_2 && HOST_bit(A_GICR, INT1)
+			&& (HOST_bit(A_GIFR, INTF1)
+					|| ((HOST_io[A_MCUCR] & 0x0C) == 0 && !HOST_bit(A_PIND, 3)))) {
+		HOST_clearBit(A_GIFR, INTF1);
+		HOST_call(__vector_2);
+	} else if (__vector_3 && HOST_bit(A_GICR, INT2) && HOST_bit(A_GIFR, INTF2)) {
+		HOST_clearBit(A_GIFR, INTF2);
+		HOST_call(__vector_3);
+	} else if (__vector_6 && HOST_bit(A_TIMSK, ICF1) && HOST_bit(A_TIFR, ICF1)) {
+		HOST_clearBit(A_TIFR, ICF1);
+		HOST_call(__vector_6);
+	} else if (__vector_7 && HOST_bit(A_TIMSK, OCF1A)
+			&& HOST_bit(A_TIFR, OCF1A)) {
+		HOST_clearBit(A_TIFR, OCF1A);
+		HOST_call(__vector_7);
+	} else if (__vector_8 && HOST_bit(A_TIMSK, OCF1B)
+			&& HOST_bit(A_TIFR, OCF1B)) {
+		HOST_clearBit(A_TIFR, OCF1B);
+		HOST_call(__vector_8);
+	} else if (__vector_9 && HOST_bit(A_TIMSK, TOV1) && HOST_bit(A_TIFR, TOV1)) {
+		HOST_clearBit(A_TIFR, TOV1);
+		HOST_call(__vector_9);
+	} else if (__vector_10 && HOST_bit(A_TIMSK, OCF0)
+			&& HOST_bit(A_TIFR, OCF0)) {
+		HOST_clearBit(A_TIFR, OCF0);
+		HOST_call(__vector_10);
+	} else if (__vector_11 && HOST_bit(A_TIMSK, TOV0)
+			&& HOST_bit(A_TIFR, TOV0)) {
+		HOST_clearBit(A_TIFR, TOV0);
+		HOST_call(__vector_11);
+	} else if (__vector_12 && HOST_bit(A_SPCR, SPIE) && HOST_bit(A_SPSR, SPIF)) {
+		HOST_clearBit(A_SPSR, SPIF);
+		HOST_call(__vector_12);
+	} else if (__vector_13 && HOST_bit(A_UCSRB, RXCIE)
+			&& HOST_bit(A_UCSRA, RXC)) {
+		HOST_call(__vector_13);
+	} else if (__vector_14 && HOST_bit(A_UCSRB, UDRIE)
+			&& HOST_bit(A_UCSRA, UDRE)) {
+		HOST_call(__vector_14);
+	} else if (__vector_15 && HOST_bit(A_UCSRB, TXCIE)
+			&& HOST_bit(A_UCSRA, TXC)) {
+		HOST_clearBit(A_UCSRA, TXC);
+		HOST_call(__vector_15);
+	} else if (__vector_19 && HOST_bit(A_TWCR, TWIE)
+			&& HOST_bit(A_TWCR, TWINT)) {
+		HOST_call(__vector_19);
+	}
+}
+
+/*******************************************************************************
+ *                      Register Access                                        *
+ *******************************************************************************/
+
+/* A driver write changed the register from old to new */
+static void HOST_onWrite(uint8 address, uint8 old, uint8 new) {
+	uint8 old_pind = HOST_io[A_PIND];
+	uint8 old_pinb = HOST_io[A_PIND + 6];
+
+	switch (address) {
+	case A_GIFR:
+		/* Write one to clear */
+		HOST_set(address, (old & ~new) | (1 << GIFR_MODEL_BIT));
+		break;
+	case A_TIFR:
+		/* Write one to clear */
+		HOST_set(address, old & ~new);
+		break;
+	case A_UCSRA:
+		/* Only U2X and MPCM are writable, TXC is cleared by writing one */
+		HOST_set(address,
+				(old & ~((1 << U2X) | (1 << MPCM)))
+						| (new & ((1 << U2X) | (1 << MPCM))));
+		if (new & (1 << TXC)) {
+			HOST_clearBit(address, TXC);
+		}
+		break;
+	case A_UCSRB:
+		/* RXB8 is read only */
+		HOST_set(address, (new & ~(1 << RXB8)) | (old & (1 << RXB8)));
+		break;
+	case A_UBRRH:
+		/* Shared location, URSEL selects UCSRC */
+		if (new & (1 << URSEL)) {
+			HOST_ucsrc = new;
+		} else {
+			HOST_ubrrh = new & 0x0F;
+		}
+		HOST_set(address, HOST_ubrrh);
+		break;
+	case A_UDR:
+		HOST_uartWrite(new);
+		HOST_uartShowRx();
+		HOST_set(address, new);
+		break;
+	case A_SPDR:
+		HOST_spiWrite(new);
+		break;
+	case A_SPSR:
+		/* Only SPI2X is writable */
+		HOST_set(address, (old & ~(1 << SPI2X)) | (new & (1 << SPI2X)));
+		break;
+	case A_TWCR:
+		if (new & (1 << TWINT)) {
+			/* Writing one clears TWINT and starts the next operation */
+			HOST_set(address, new & ~((1 << TWINT) | (1 << TWCR_MODEL_BIT)));
+			if (new & (1 << TWEN)) {
+				HOST_twiCommand(new);
+			}
+		} else {
+			HOST_set(address,
+					(new & ~(1 << TWCR_MODEL_BIT))
+							| (old & ((1 << TWINT) | (1 << TWCR_MODEL_BIT))));
+		}
+		break;
+	case A_TWSR:
+		/* Only the prescaler bits are writable */
+		HOST_set(address, (old & 0xF8) | (new & 3));
+		break;
+	case A_TCCR0:
+		/* FOC0 is a strobe and always reads zero */
+		HOST_set(address, new & 0x7F);
+		break;
+	default:
+		if (address >= A_PIND && address <= A_PORTA) {
+			if ((address - A_PIND) % 3 == 0) {
+				/* PINx is read only on the ATmega32 */
+				HOST_set(address, old);
+			}
+			HOST_updatePins();
+			HOST_pinsChanged(old_pind, old_pinb);
+		}
+		break;
+	}
+}
+
+/* UDR/SPDR accessed without a value change, decide between a read and a write */
+static void HOST_onAccess(uint8 address) {
+	switch (address) {
+	case A_UDR:
+		if (HOST_uartRxPendingAtAccess) {
+			HOST_uartPop();
+		} else {
+			HOST_uartWrite(HOST_io[A_UDR]);
+		}
+		break;
+	case A_SPDR:
+		if (HOST_spiPendingAtAccess) {
+			HOST_spiRxUnread = FALSE;
+		} else {
+			HOST_spiWrite(HOST_io[A_SPDR]);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* Give the register its read value before the driver accesses it */
+static void HOST_prepareAccess(uint8 address) {
+	switch (address) {
+	case A_UDR:
+		HOST_uartRxPendingAtAccess = HOST_bit(A_UCSRA, RXC);
+		if (HOST_uartRxPendingAtAccess) {
+			HOST_set(A_UDR, (uint8) HOST_uartRxFifo[0].data);
+		}
+		HOST_accessed[address] = TRUE;
+		break;
+	case A_SPDR:
+		/* Reading SPSR with SPIF set then accessing SPDR clears SPIF and WCOL */
+		HOST_spiPendingAtAccess = HOST_spiRxUnread;
+		if (HOST_spiArmed) {
+			HOST_spiArmed = FALSE;
+			HOST_set(A_SPSR, HOST_io[A_SPSR] & ~((1 << SPIF) | (1 << WCOL)));
+		}
+		HOST_set(A_SPDR, HOST_spiRx);
+		HOST_accessed[address] = TRUE;
+		break;
+	case A_SPSR:
+		HOST_spiArmed = HOST_bit(A_SPSR, SPIF);
+		break;
+	default:
+		break;
+	}
+}
+
+void HOST_reset(void) {
+	uint8 i;
+
+	for (i = 0; i < HOST_IO_SIZE; i++) {
+		HOST_io[i] = 0;
+		HOST_shadow[i] = 0;
+		HOST_accessed[i] = FALSE;
+		HOST_accessCount[i] = 0;
+	}
+	for (i = 0; i < 4; i++) {
+		HOST_pinLevel[i] = 0xFF;
+	}
+	for (i = 0; i < HOST_TWI_MAX_SLAVES; i++) {
+		HOST_twiSlaves[i] = NULL_PTR;
+	}
+	HOST_totalAccessCount = 0;
+	HOST_cycles = 0;
+	HOST_inIsr = FALSE;
+	HOST_timer0Prescale = 0;
+	HOST_timer1Prescale = 0;
+	HOST_ucsrc = (1 << URSEL) | (1 << UCSZ1) | (1 << UCSZ0);
+	HOST_ubrrh = 0;
+	HOST_uartRxHead = 0;
+	HOST_uartRxCount = 0;
+	HOST_uartRxFifoCount = 0;
+	HOST_uartTxLogHead = 0;
+	HOST_uartTxLogCount = 0;
+	HOST_uartTxBufferFull = FALSE;
+	HOST_uartTxShiftBusy = FALSE;
+	HOST_spiPeer = NULL_PTR;
+	HOST_spiBusy = FALSE;
+	HOST_spiArmed = FALSE;
+	HOST_spiRxUnread = FALSE;
+	HOST_spiRx = 0;
+	HOST_spiTx = 0;
+	HOST_twiActive = NULL_PTR;
+	HOST_twiOwnsBus = FALSE;
+	HOST_twiBusy = FALSE;
+	HOST_twiStopPending = FALSE;
+	HOST_twiSlaveActive = FALSE;
+	HOST_twiLastAck = FALSE;
+	HOST_twiLastData = 0;
+
+	/* Reset values */
+	HOST_set(A_UCSRA, 1 << UDRE);
+	HOST_set(A_TWSR, TW_NO_INFO);
+	HOST_set(A_GIFR, 1 << GIFR_MODEL_BIT);
+	HOST_set16(A_SP, 0x085F);
+	HOST_updatePins();
+	HOST_initialized = TRUE;
+}
+
+void HOST_sync(void) {
+	uint8 address;
+	uint8 old;
+
+	if (!HOST_initialized) {
+		HOST_reset();
+	}
+	for (address = HOST_IO_FIRST; address < HOST_IO_SIZE; address++) {
+		if (HOST_io[address] != HOST_shadow[address]) {
+			old = HOST_shadow[address];
+			HOST_shadow[address] = HOST_io[address];
+			HOST_onWrite(address, old, HOST_io[address]);
+		} else if (HOST_accessed[address]) {
+			HOST_onAccess(address);
+		}
+		HOST_accessed[address] = FALSE;
+	}
+}
+
+static void HOST_step(uint32 cycles) {
+	HOST_cycles += cycles;
+	HOST_timersStep(cycles);
+	HOST_uartStep(cycles);
+	HOST_spiStep(cycles);
+	HOST_twiStep(cycles);
+	HOST_dispatchInterrupts();
+}
+
+void HOST_advanceCycles(uint32 cycles) {
+	uint32 step;
+
+	HOST_sync();
+	while (cycles > 0) {
+		step = (cycles > HOST_MAX_STEP_CYCLES) ? HOST_MAX_STEP_CYCLES : cycles;
+		HOST_step(step);
+		cycles -= step;
+	}
+}
+
+uint64 HOST_getCycles(void) {
+	return HOST_cycles;
+}
+
+volatile uint8* HOST_register8(uint8 address) {
+	HOST_sync();
+	HOST_step(HOST_CYCLES_PER_ACCESS);
+	HOST_accessCount[address]++;
+	HOST_totalAccessCount++;
+	HOST_prepareAccess(address);
+	return (volatile uint8*) &HOST_io[address];
+}
+
+volatile uint16* HOST_register16(uint8 address) {
+	HOST_sync();
+	HOST_step(HOST_CYCLES_PER_ACCESS);
+	HOST_accessCount[address]++;
+	HOST_totalAccessCount++;
+	return (volatile uint16*) &HOST_io[address];
+}
+
+void HOST_resetAccessCounters(void) {
+	uint8 i;
+
+	HOST_sync();
+	for (i = 0; i < HOST_IO_SIZE; i++) {
+		HOST_accessCount[i] = 0;
+	}
+	HOST_totalAccessCount = 0;
+}
+
+uint32 HOST_getAccessCount(void) {
+	HOST_sync();
+	return HOST_totalAccessCount;
+}
+
+uint32 HOST_getRegisterAccessCount(uint8 address) {
+	HOST_sync();
+	return (address < HOST_IO_SIZE) ? HOST_accessCount[address] : 0;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file host_model.h
+ * @brief Header file for the host register model.
+ * @version 1.0
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ *
+ * @details
+ * When the drivers are compiled with HOST_BUILD defined, Atmega32_Registers.h maps
+ * every register to this model instead of the fixed I/O addresses, so gpio.c, uart.c,
+ * spi.c, twi.c, timer_0.c, lcd.c ... compile and run unmodified on an x86 Linux host:
+ *
+ *     gcc -DHOST_BUILD -DF_CPU=8000000UL -I. app.c MCAL/gpio/gpio.c delay.c \
+ *         MCAL/Host_Model/host_model.c
+ *
+ * The regression tests in Tests/ run the drivers this way: make test builds and
+ * runs every Tests/test_*.c program and fails on the first failing check.
+ *
+ * The model keeps a copy of the whole I/O space. Every register access goes through
+ * HOST_register8/HOST_register16, which first processes the writes done through the
+ * previous access, advances the simulated time by HOST_CYCLES_PER_ACCESS and counts
+ * the access.
+ *
+ * The simulated time (HOST_getCycles, HOST_advanceCycles, the timers and TCNT1 read
+ * by the profiler) is a register-access count, not an instruction count: the code
+ * between two accesses costs nothing, so a driver function "takes" its number of
+ * register accesses times HOST_CYCLES_PER_ACCESS and a pure computation takes 0.
+ * Only the peripheral timings (UART frames, SPI and TWI clocks, timer prescalers)
+ * are in real F_CPU cycles. Compare two versions of a driver with it, never quote
+ * its figures as AVR cycles.
+ *
+ * std_types.h takes the <stdint.h> fixed-width types under HOST_BUILD, so uint32 and
+ * sint32 are 32-bit on the host too and overflow as on the target. int is still
+ * 32-bit instead of 16-bit, so the integer promotions differ from avr-gcc.
+ *
+ * The behavioral stand-ins are:
+ *  - GPIO  : PINx follows PORTx for outputs and HOST_setPin levels for inputs.
+ *  - EXTI  : INT0/INT1/INT2 flags from the HOST_setPin edges and the ISCxx settings.
+ *  - Timer0: counting with the CS0 prescaler, normal and CTC modes, TOV0/OCF0.
+ *  - Timer1: counting with the CS1 prescaler, normal and CTC (OCR1A) modes,
+ *            TOV1/OCF1A/OCF1B, input capture of the ICP1 (D6) edges into ICR1.
+ *  - UART  : UBRR/U2X/frame format timing, UDR TX buffer + shift register with the
+ *            UDRE/TXC flags, 2 level RX FIFO with RXC/DOR/FE/PE, 9-bit frames and
+ *            MPCM address filtering.
+ *  - SPI   : master transfers timed by SPR1:0/SPI2X with SPIF/WCOL, slave transfers
+ *            clocked by HOST_spiMasterTransfer.
+ *  - TWI   : master START/SLA/data/STOP sequencing timed by TWBR/TWPS with the TWINT
+ *            flag and the TWSR status codes, answered by HOST_TwiSlave devices. Slave
+ *            receive/transmit (TWAR, TWGCE, TWEA) driven by the HOST_twiMaster calls.
+ *  - Interrupts: the driver ISRs (__vector_N) are called when their enable bit, their
+ *            flag and the SREG I-bit are set, one ISR between two main line accesses.
+ *
+ * Limitations: a register write is seen when its value differs from the register
+ * contents, except UDR and SPDR where an access that leaves the value unchanged is
+ * taken as a read when receive data is pending (RXC set / SPI byte not read yet)
+ * and as a write otherwise. A write-one-to-clear of TIFR that rewrites exactly the current flags is
+ * seen as a read. Simulated time only moves on register accesses and HOST_ calls, so
+ * a loop waiting on a variable written by an ISR must call HOST_advanceCycles.
+ */
+
+#ifndef ATMEGA32_DRIVERS_HOST_MODEL_H_
+#define ATMEGA32_DRIVERS_HOST_MODEL_H_
+
+#include "../../std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* Simulated time spent per register access, the only cost the model charges */
+#define HOST_CYCLES_PER_ACCESS 2
+
+/* Maximum number of TWI slave devices attached to the simulated bus */
+#define HOST_TWI_MAX_SLAVES 4
+
+/*******************************************************************************
+ *                      Types Declaration                                      *
+ *******************************************************************************/
+
+/**
+ * @brief the SPI device answering the master transfers, returns the MISO byte.
+ */
+typedef uint8 (*HOST_SpiPeer)(uint8 mosi);
+
+/**
+ * @brief a TWI slave device on the simulated bus, the unused handlers can be NULL_PTR.
+ */
+typedef struct {
+	uint8 address; /**< 7-bit slave address */
+	boolean (*start)(boolean read); /**< addressed by SLA+R/W, return TRUE to ACK */
+	boolean (*write)(uint8 data); /**< data byte from the master, return TRUE to ACK */
+	uint8 (*read)(void); /**< data byte requested by the master */
+	void (*stop)(void); /**< STOP or repeated START after the transaction */
+} HOST_TwiSlave;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/* Register access, used by the IO_REG8/IO_REG16 macros of Atmega32_Registers.h */
+volatile uint8* HOST_register8(uint8 address);
+volatile uint16* HOST_register16(uint8 address);
+
+/* Put every register back to its reset value and clear the peers and counters */
+void HOST_reset(void);
+
+/* Process the register writes not yet seen by the model */
+void HOST_sync(void);
+
+/* Simulated time */
+void HOST_advanceCycles(uint32 cycles);
+uint64 HOST_getCycles(void);
+
+/* Register access accounting, the address is the data-space address (UDR = 0x2C) */
+void HOST_resetAccessCounters(void);
+uint32 HOST_getAccessCount(void);
+uint32 HOST_getRegisterAccessCount(uint8 address);
+
+/* GPIO: external level applied on an input pin (A0..D7) */
+void HOST_setPin(uint8 pin_num, uint8 level);
+
+/* UART peer: frames sent to the RXD pin and frames captured on the TXD pin */
+void HOST_uartInject(const uint8 *data, uint16 length);
+void HOST_uartInjectFrame(uint16 data, uint8 error_flags);
+uint16 HOST_uartTake(uint8 *data, uint16 max_length);
+uint16 HOST_uartTakeFrames(uint16 *frames, uint16 max_length);
+
+/* SPI peers */
+void HOST_spiSetPeer(HOST_SpiPeer peer);
+uint8 HOST_spiMasterTransfer(uint8 mosi);
+
+/* TWI peers */
+void HOST_twiAttachSlave(const HOST_TwiSlave *slave);
+
+/* TWI external master addressing this MCU, each call waits for the driver ISR */
+boolean HOST_twiMasterStart(uint8 sla_rw);
+boolean HOST_twiMasterWrite(uint8 data);
+uint8 HOST_twiMasterRead(boolean ack);
+void HOST_twiMasterStop(void);
+
+#endif /* ATMEGA32_DRIVERS_HOST_MODEL_H_ */
@@ -10,6 +10,7 @@ static uint8 selectedClk;
 Timer1Callback TIMER1_overflow_callback = NULL_PTR;
 Timer1Callback TIMER1_compare_match_A_callback = NULL_PTR;
 Timer1Callback TIMER1_compare_match_B_callback = NULL_PTR;
+Timer1Callback TIMER1_input_capture_callback = NULL_PTR;
 
 void TIMER1_SetMode(TIMER1_MODE mode) {
 	TCCR1A = TCCR1A & 0b11111100;
@@ -73,6 +74,9 @@ static void TIMER1_enable_interrupt(TIMER1_interrupt_type interrupt) {
 	case TIMER1_INTERRUPT_OUTPUT_COMPARE_MATCH_B:
 		TIMSK = TIMSK | (1 << 3);
 		break;
+	case TIMER1_INTERRUPT_INPUT_CAPTURE:
+		TIMSK = TIMSK | (1 << 5);
+		break;
 	default:
 		break;
 	}
@@ -91,6 +95,9 @@ static void TIMER1_disable_interrupt(TIMER1_interrupt_type interrupt) {
 	case TIMER1_INTERRUPT_OUTPUT_COMPARE_MATCH_B:
 		TIMSK = TIMSK & ~(1 << 3);
 		break;
+	case TIMER1_INTERRUPT_INPUT_CAPTURE:
+		TIMSK = TIMSK & ~(1 << 5);
+		break;
 	default:
 		break;
 	}
@@ -150,3 +157,93 @@ void TIMER1_set_CTC_B_Callback(Timer1Callback callback) {
 	TIMER1_compare_match_B_callback = callback;
 
 }
+
+void TIMER1_set_ICU_Edge(TIMER1_ICU_Edge edge) {
+	//TCCR1B -> ICNC1 | ICES1 | R | WGM13 | WGM12 | CS12 | CS11 | CS10
+	TCCR1B = (TCCR1B & 0b10111111) | (edge << 6);
+}
+
+void TIMER1_set_ICU_NoiseCanceler(boolean enable) {
+	TCCR1B = (TCCR1B & 0b01111111) | ((enable ? 1 : 0) << 7);
+}
+
+uint16 TIMER1_get_ICU_Value(void) {
+	return ICR1;
+}
+
+void TIMER1_enable_ICU_Interrupt(void) {
+	TIMER1_enable_interrupt(TIMER1_INTERRUPT_INPUT_CAPTURE);
+}
+
+void TIMER1_disable_ICU_Interrupt(void) {
+	TIMER1_disable_interrupt(TIMER1_INTERRUPT_INPUT_CAPTURE);
+}
+
+uint8 TIMER1_get_ICU_Flag(void) {
+	return GET_BIT(TIFR, 5);
+}
+
+void TIMER1_clear_ICU_Flag(void) {
+	/* Write one to clear, the other flags are written as zero */
+	TIFR = (1 << 5);
+}
+
+void TIMER1_set_ICU_Callback(Timer1Callback callback) {
+	TIMER1_input_capture_callback = callback;
+}
+
+/**
+ * @brief call the ISR function with the given Callback.
+ *
+ */
+#define TIMER1_CAPT_ISR __vector_6
+
+void TIMER1_CAPT_ISR(void)__attribute__((signal, used, externally_visible));
+
+void TIMER1_CAPT_ISR(void) {
+	if (TIMER1_input_capture_callback != NULL_PTR) {
+		TIMER1_input_capture_callback();
+	}
+}
+
+/**
+ * @brief call the ISR function with the given Callback.
+ *
+ */
+#define TIMER1_COMPA_ISR __vector_7
+
+void TIMER1_COMPA_ISR(void)__attribute__((signal, used, externally_visible));
+
+void TIMER1_COMPA_ISR(void) {
+	if (TIMER1_compare_match_A_callback != NULL_PTR) {
+		TIMER1_compare_match_A_callback();
+	}
+}
+
+/**
+ * @brief call the ISR function with the given Callback.
+ *
+ */
+#define TIMER1_COMPB_ISR __vector_8
+
+void TIMER1_COMPB_ISR(void)__attribute__((signal, used, externally_visible));
+
+void TIMER1_COMPB_ISR(void) {
+	if (TIMER1_compare_match_B_callback != NULL_PTR) {
+		TIMER1_compare_match_B_callback();
+	}
+}
+
+/**
+ * @brief call the ISR function with the given Callback.
+ *
+ */
+#define TIMER1_OVF_ISR __vector_9
+
+void TIMER1_OVF_ISR(void)__attribute__((signal, used, externally_visible));
+
+void TIMER1_OVF_ISR(void) {
+	if (TIMER1_overflow_callback != NULL_PTR) {
+		TIMER1_overflow_callback();
+	}
+}
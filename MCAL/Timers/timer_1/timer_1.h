@@ -11,6 +11,9 @@
  * Timer 1 is a hardware timer in the AVR Microcontroller used for various timing and
  * counting operations. This module provides functionalities to initialize Timer 1,
  * set its mode of operation, configure interrupts, and control its behavior.
+ *
+ * Timer 1 is also used by the profiler (profiler.h) and by the auto-baud detection
+ * (HAL/Auto_Baud), only one of them can own it at a time.
  */
 
 #ifndef ATMEGA32_DRIVERS_TIMER_1_H_
@@ -92,9 +95,22 @@ typedef enum {
     TIMER1_INTERRUPT_OVERFLOW,
     TIMER1_INTERRUPT_OUTPUT_COMPARE_MATCH_A,
     TIMER1_INTERRUPT_OUTPUT_COMPARE_MATCH_B,
+    TIMER1_INTERRUPT_INPUT_CAPTURE,
 
 } TIMER1_interrupt_type;
 
+/*
+ TCCR1B -> ICNC1 | ICES1 | R | WGM13 | WGM12 | CS12 | CS11 | CS10
+
+ ICES1 -> Input Capture Edge Select of the ICP1 pin (PD6), TCNT1 is copied to ICR1
+ on the selected edge and ICF1 is set.
+ ICNC1 -> Input Capture Noise Canceler, the edge must be stable for 4 system clocks,
+ it delays every capture by the same 4 clocks.
+ */
+typedef enum {
+    TIMER1_ICU_FALLING_EDGE, TIMER1_ICU_RISING_EDGE
+} TIMER1_ICU_Edge;
+
 typedef void (*Timer1Callback)(void);
 
 void TIMER1_SetMode(TIMER1_MODE);
@@ -139,4 +155,20 @@ void TIMER1_set_CTC_A_Callback(Timer1Callback);
 
 void TIMER1_set_CTC_B_Callback(Timer1Callback);
 
+void TIMER1_set_ICU_Edge(TIMER1_ICU_Edge edge);
+
+void TIMER1_set_ICU_NoiseCanceler(boolean enable);
+
+uint16 TIMER1_get_ICU_Value(void);
+
+void TIMER1_enable_ICU_Interrupt(void);
+
+void TIMER1_disable_ICU_Interrupt(void);
+
+uint8 TIMER1_get_ICU_Flag(void);
+
+void TIMER1_clear_ICU_Flag(void);
+
+void TIMER1_set_ICU_Callback(Timer1Callback);
+
 #endif /* ATMEGA32_DRIVERS_TIMER_1_H_ */
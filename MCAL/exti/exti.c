@@ -0,0 +1,159 @@
+/**
+ * @file exti.c
+ * @brief Source file for External Interrupt (EXTI) driver module.
+ * @version 1.0
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ *
+ * @details
+ * This source file contains the implementations of the External Interrupt driver
+ * module: sense control configuration, enable/disable of the INT0, INT1 and INT2
+ * lines and the interrupt service routines that call the user callbacks.
+ */
+
+#include "exti.h"
+#include "../gpio/gpio.h"
+#include "../Atmega32_Registers.h"
+
+#define EXTI_NUM_OF_LINES 3
+
+/**
+ * @brief the user callbacks, indexed by EXTI_Line.
+ */
+static volatile ExtiCallback EXTI_callbacks[EXTI_NUM_OF_LINES] = { NULL_PTR,
+		NULL_PTR, NULL_PTR };
+
+/**
+ * @brief GICR/GIFR bit of each line, the same position is used in both registers.
+ */
+static const uint8 EXTI_bits[EXTI_NUM_OF_LINES] = { INT0, INT1, INT2 };
+
+/**
+ * @brief pin of each line.
+ */
+static const uint8 EXTI_pins[EXTI_NUM_OF_LINES] = { D2, D3, B2 };
+
+void EXTI_init(EXTI_Line line, EXTI_SenseControl sense) {
+	if (line >= EXTI_NUM_OF_LINES) {
+		return;
+	}
+	EXTI_disable(line);
+	GPIO_setupPinDirection(EXTI_pins[line], PIN_INPUT);
+	EXTI_setSenseControl(line, sense);
+	EXTI_clearFlag(line);
+}
+
+void EXTI_setSenseControl(EXTI_Line line, EXTI_SenseControl sense) {
+	uint8 enabled;
+
+	switch (line) {
+	case EXTI_INT0:
+		MCUCR = (MCUCR & ~((1 << ISC01) | (1 << ISC00))) | (sense << ISC00);
+		break;
+	case EXTI_INT1:
+		MCUCR = (MCUCR & ~((1 << ISC11) | (1 << ISC10))) | (sense << ISC10);
+		break;
+	case EXTI_INT2:
+		/* INT2 has edge sense only, the level/any change settings are not handled */
+		if (sense == EXTI_SENSE_FALLING_EDGE || sense == EXTI_SENSE_RISING_EDGE) {
+			/* Changing ISC2 can set INTF2, so disable the line and clear the flag */
+			enabled = BIT_IS_SET(GICR, INT2);
+			CLEAR_BIT(GICR, INT2);
+			if (sense == EXTI_SENSE_RISING_EDGE) {
+				SET_BIT(MCUCSR, ISC2);
+			} else {
+				CLEAR_BIT(MCUCSR, ISC2);
+			}
+			EXTI_clearFlag(EXTI_INT2);
+			if (enabled) {
+				SET_BIT(GICR, INT2);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void EXTI_enable(EXTI_Line line) {
+	if (line < EXTI_NUM_OF_LINES) {
+		SET_BIT(GICR, EXTI_bits[line]);
+	}
+}
+
+void EXTI_disable(EXTI_Line line) {
+	if (line < EXTI_NUM_OF_LINES) {
+		CLEAR_BIT(GICR, EXTI_bits[line]);
+	}
+}
+
+void EXTI_clearFlag(EXTI_Line line) {
+	if (line < EXTI_NUM_OF_LINES) {
+		/* The flag is cleared by writing one, a plain write leaves the other flags */
+		GIFR = (1 << EXTI_bits[line]);
+	}
+}
+
+uint8 EXTI_getFlag(EXTI_Line line) {
+	if (line >= EXTI_NUM_OF_LINES) {
+		return 0;
+	}
+	return GET_BIT(GIFR, EXTI_bits[line]);
+}
+
+/**
+ * @brief this function take a callback function from the user and save it's memory location to be used by the ISR later.
+ *
+ * @param line
+ * @param callback
+ */
+void EXTI_setCallback(EXTI_Line line, ExtiCallback callback) {
+	if (line < EXTI_NUM_OF_LINES) {
+		EXTI_callbacks[line] = callback;
+	}
+}
+
+/**
+ * @brief call the ISR function with the given Callback.
+ *
+ */
+#define EXTI_INT0_ISR __vector_1
+
+void EXTI_INT0_ISR(void)__attribute__((signal, used, externally_visible));
+
+void EXTI_INT0_ISR(void) {
+	ExtiCallback callback = EXTI_callbacks[EXTI_INT0];
+	if (callback != NULL_PTR) {
+		callback();
+	}
+}
+
+/**
+ * @brief call the ISR function with the given Callback.
+ *
+ */
+#define EXTI_INT1_ISR __vector_2
+
+void EXTI_INT1_ISR(void)__attribute__((signal, used, externally_visible));
+
+void EXTI_INT1_ISR(void) {
+	ExtiCallback callback = EXTI_callbacks[EXTI_INT1];
+	if (callback != NULL_PTR) {
+		callback();
+	}
+}
+
+/**
+ * @brief call the ISR function with the given Callback.
+ *
+ */
+#define EXTI_INT2_ISR __vector_3
+
+void EXTI_INT2_ISR(void)__attribute__((signal, used, externally_visible));
+
+void EXTI_INT2_ISR(void) {
+	ExtiCallback callback = EXTI_callbacks[EXTI_INT2];
+	if (callback != NULL_PTR) {
+		callback();
+	}
+}
@@ -0,0 +1,95 @@
+/**
+ * @file exti.h
+ * @brief Header file for External Interrupt (EXTI) driver module.
+ * @version 1.0
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ *
+ * @details
+ * This header file contains the definitions and the prototypes of the External
+ * Interrupt driver module. The ATmega32 has three external interrupt lines INT0 (PD2),
+ * INT1 (PD3) and INT2 (PB2). This module configures their sense control, enables and
+ * disables them and calls a user callback from the interrupt service routine, so
+ * events are handled on the edge instead of being polled from the main loop.
+ */
+
+#ifndef ATMEGA32_DRIVERS_EXTI_H_
+#define ATMEGA32_DRIVERS_EXTI_H_
+
+#include "../../std_types.h"
+#include "../../common_macros.h"
+
+/**
+ @brief Here you can find all the the information related to the External
+ Interrupts hardware found in the official data sheet.
+
+ REGISTERS:
+ MCUCR  -> SE    | SM2  | SM1  | SM0 | ISC11 | ISC10 | ISC01 | ISC00
+ MCUCSR -> JTD   | ISC2 | R    | JTRF| WDRF  | BORF  | EXTRF | PORF
+ GICR   -> INT1  | INT0 | INT2 | R   | R     | R     | IVSEL | IVCE
+ GIFR   -> INTF1 | INTF0| INTF2| R   | R     | R     | R     | R
+
+ ISC11:0 / ISC01:0 -> Sense Control of INT1 / INT0
+ -----------------------------------------------
+ ISCx1	|	 ISCx0	|	Description				|
+ -----------------------------------------------
+ 0		|	  0		|	low level				|
+ 0		|	  1		| 	any logical change		|
+ 1		|	  0		| 	falling edge			|
+ 1		|	  1     |	rising edge				|
+ -----------------------------------------------
+
+ ISC2 -> Sense Control of INT2 (edge only)
+ ISC2 -> 0 falling edge, 1 rising edge.
+ ISC2 -> INT2 must be disabled while ISC2 is changed and its flag cleared afterwards.
+
+ GICR INTx -> 1 to enable the line, you must enable the I-bit to allow system interrupts.
+ GIFR INTFx -> set by the edge, cleared by hardware when the ISR runs or by writing one.
+ */
+
+/**
+ * @brief this enum holds the external interrupt lines
+ *
+ */
+typedef enum {
+	EXTI_INT0, /**< INT0 on PD2 */
+	EXTI_INT1, /**< INT1 on PD3 */
+	EXTI_INT2, /**< INT2 on PB2 (edge sense only) */
+} EXTI_Line;
+
+/**
+ * @brief this enum holds the sense control settings, the values match ISCx1:0
+ *
+ */
+typedef enum {
+	EXTI_SENSE_LOW_LEVEL, /**< EXTI_SENSE_LOW_LEVEL (INT0/INT1 only) */
+	EXTI_SENSE_ANY_CHANGE, /**< EXTI_SENSE_ANY_CHANGE (INT0/INT1 only) */
+	EXTI_SENSE_FALLING_EDGE, /**< EXTI_SENSE_FALLING_EDGE */
+	EXTI_SENSE_RISING_EDGE, /**< EXTI_SENSE_RISING_EDGE */
+} EXTI_SenseControl;
+
+/**
+ * @brief used to define the type of the callback function
+ *
+ */
+typedef void (*ExtiCallback)(void);
+
+/**
+ * @brief configure the pin of the line as input, set its sense control and clear its
+ * pending flag, the line stays disabled until EXTI_enable is called.
+ */
+void EXTI_init(EXTI_Line line, EXTI_SenseControl sense);
+
+void EXTI_setSenseControl(EXTI_Line line, EXTI_SenseControl sense);
+
+void EXTI_enable(EXTI_Line line);
+
+void EXTI_disable(EXTI_Line line);
+
+void EXTI_clearFlag(EXTI_Line line);
+
+uint8 EXTI_getFlag(EXTI_Line line);
+
+void EXTI_setCallback(EXTI_Line line, ExtiCallback callback);
+
+#endif /* ATMEGA32_DRIVERS_EXTI_H_ */
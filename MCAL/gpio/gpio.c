@@ -11,7 +11,7 @@
  *******************************************************************************/
 
 #include "gpio.h"
-#include "..\..\common_macros.h" /* To use the macros like SET_BIT */
+#include "../../common_macros.h" /* To use the macros like SET_BIT */
 #include "../Atmega32_Registers.h"
 
 
@@ -70,7 +70,7 @@ void GPIO_setupPinDirection(uint8 pin_num, GPIO_PinDirectionType direction) {
  * If the input port number or pin number are not correct, The function will not handle the request.
  * If the pin is input, this function will enable/disable the internal pull-up resistor.
  */
-void GPIO_writePin(uint8 pin_num, uint8 value) {
+void GPIO_writePin(uint8 pin_num, GPIO_LogicType value) {
 	/*
 	 * Check if the input port number is greater than NUM_OF_PINS_PER_PORT value.
 	 * Or if the input pin number is greater than NUM_OF_PINS_PER_PORT value.
@@ -294,3 +294,211 @@ void GPIO_disablePullUp(uint8 pin_num) {
 		break;
 	}
 }
+
+/*
+ * Description :
+ * Replace the bits selected by the mask in the required register of the port
+ * (PORTx when direction_reg is FALSE, DDRx otherwise) with a single read-modify-write.
+ * The global interrupts are disabled during the read-modify-write and SREG is restored
+ * afterwards, so it is safe against ISRs touching the same port.
+ */
+static void GPIO_writePortMasked(uint8 port_num, uint8 mask, uint8 value,
+		boolean direction_reg) {
+	uint8 sreg = SREG;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	switch (port_num) {
+	case PORTA_ID:
+		if (direction_reg) {
+			DDRA = (DDRA & ~mask) | (value & mask);
+		} else {
+			PORTA = (PORTA & ~mask) | (value & mask);
+		}
+		break;
+	case PORTB_ID:
+		if (direction_reg) {
+			DDRB = (DDRB & ~mask) | (value & mask);
+		} else {
+			PORTB = (PORTB & ~mask) | (value & mask);
+		}
+		break;
+	case PORTC_ID:
+		if (direction_reg) {
+			DDRC = (DDRC & ~mask) | (value & mask);
+		} else {
+			PORTC = (PORTC & ~mask) | (value & mask);
+		}
+		break;
+	case PORTD_ID:
+		if (direction_reg) {
+			DDRD = (DDRD & ~mask) | (value & mask);
+		} else {
+			PORTD = (PORTD & ~mask) | (value & mask);
+		}
+		break;
+	default:
+		/*DO NOTHING*/
+		break;
+	}
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Build the port masks and the bit-scatter table of a pin group.
+ * pins[i] is the pin driven by bit i of the values written to the group.
+ * Invalid pin numbers are ignored and at most GPIO_GROUP_MAX_PINS pins are used.
+ */
+void GPIO_setupPinGroup(GPIO_PinGroup *group, const uint8 *pins,
+		uint8 pin_count) {
+	uint8 i;
+
+	if (pin_count > GPIO_GROUP_MAX_PINS) {
+		pin_count = GPIO_GROUP_MAX_PINS;
+	}
+	for (i = 0; i < NUM_OF_PORTS; i++) {
+		group->port_mask[i] = 0;
+	}
+	for (i = 0; i < pin_count; i++) {
+		if (pins[i] > D7) {
+			/* Invalid pin, value bit i will not drive anything */
+			group->bit_port[i] = PORTA_ID;
+			group->bit_mask[i] = 0;
+		} else {
+			group->bit_port[i] = pins[i] / NUM_OF_PINS_PER_PORT;
+			group->bit_mask[i] = (uint8) (1 << (pins[i] % NUM_OF_PINS_PER_PORT));
+			group->port_mask[group->bit_port[i]] |= group->bit_mask[i];
+		}
+	}
+	group->pin_count = pin_count;
+}
+
+/*
+ * Description :
+ * Setup the direction of all the pins of the group input/output.
+ */
+void GPIO_setupPinGroupDirection(const GPIO_PinGroup *group,
+		GPIO_PinDirectionType direction) {
+	uint8 port_num;
+
+	for (port_num = 0; port_num < NUM_OF_PORTS; port_num++) {
+		if (group->port_mask[port_num] != 0) {
+			GPIO_writePortMasked(port_num, group->port_mask[port_num],
+					(direction == PIN_OUTPUT) ? 0xFF : 0x00, TRUE);
+		}
+	}
+}
+
+/*
+ * Description :
+ * Write the value on the pins of the group, bit i of the value goes to the i-th pin.
+ * Each port touched by the group is updated with a single read-modify-write, so the
+ * pins of the same port change together without intermediate states.
+ */
+void GPIO_writePinGroup(const GPIO_PinGroup *group, uint8 value) {
+	uint8 port_value[NUM_OF_PORTS] = { 0 };
+	uint8 i;
+
+	/* Scatter the value bits to their ports */
+	for (i = 0; i < group->pin_count; i++) {
+		if (value & 1) {
+			port_value[group->bit_port[i]] |= group->bit_mask[i];
+		}
+		value >>= 1;
+	}
+	/* One masked read-modify-write per port used by the group */
+	for (i = 0; i < NUM_OF_PORTS; i++) {
+		if (group->port_mask[i] != 0) {
+			GPIO_writePortMasked(i, group->port_mask[i], port_value[i], FALSE);
+		}
+	}
+}
+
+/*
+ * Description :
+ * Set the required pin to Logic High, interrupt-safe.
+ */
+void GPIO_setPinAtomic(uint8 pin_num) {
+	GPIO_writePortMasked(pin_num / NUM_OF_PINS_PER_PORT,
+			(uint8) (1 << (pin_num % NUM_OF_PINS_PER_PORT)), 0xFF, FALSE);
+}
+
+/*
+ * Description :
+ * Set the required pin to Logic Low, interrupt-safe.
+ */
+void GPIO_clearPinAtomic(uint8 pin_num) {
+	GPIO_writePortMasked(pin_num / NUM_OF_PINS_PER_PORT,
+			(uint8) (1 << (pin_num % NUM_OF_PINS_PER_PORT)), 0x00, FALSE);
+}
+
+/*
+ * Description :
+ * Toggle the required pin, interrupt-safe.
+ * With GPIO_PINX_TOGGLE a one is written to PINx and the hardware does the toggle,
+ * otherwise PORTx is XORed with the global interrupts disabled.
+ */
+void GPIO_togglePin(uint8 pin_num) {
+	uint8 port_num = pin_num / NUM_OF_PINS_PER_PORT;
+	uint8 mask = (uint8) (1 << (pin_num % NUM_OF_PINS_PER_PORT));
+#if defined (GPIO_PINX_TOGGLE)
+	switch (port_num) {
+	case PORTA_ID:
+		PINA = mask;
+		break;
+	case PORTB_ID:
+		PINB = mask;
+		break;
+	case PORTC_ID:
+		PINC = mask;
+		break;
+	case PORTD_ID:
+		PIND = mask;
+		break;
+	default:
+		/*DO NOTHING*/
+		break;
+	}
+#else
+	uint8 sreg = SREG;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	switch (port_num) {
+	case PORTA_ID:
+		PORTA ^= mask;
+		break;
+	case PORTB_ID:
+		PORTB ^= mask;
+		break;
+	case PORTC_ID:
+		PORTC ^= mask;
+		break;
+	case PORTD_ID:
+		PORTD ^= mask;
+		break;
+	default:
+		/*DO NOTHING*/
+		break;
+	}
+	SREG = sreg;
+#endif
+}
+
+/*
+ * Description :
+ * Setup the direction of the required pin input/output, interrupt-safe.
+ */
+void GPIO_setupPinDirectionAtomic(uint8 pin_num, GPIO_PinDirectionType direction) {
+	GPIO_writePortMasked(pin_num / NUM_OF_PINS_PER_PORT,
+			(uint8) (1 << (pin_num % NUM_OF_PINS_PER_PORT)),
+			(direction == PIN_OUTPUT) ? 0xFF : 0x00, TRUE);
+}
+
+/*
+ * Description :
+ * Replace the bits selected by the mask in the port output register with the same bits
+ * of the value, interrupt-safe.
+ */
+void GPIO_modifyPortAtomic(uint8 port_num, uint8 mask, uint8 value) {
+	GPIO_writePortMasked(port_num, mask, value, FALSE);
+}
@@ -13,7 +13,7 @@
 #ifndef ATMEGA32_DRIVERS_GPIO_H_
 #define ATMEGA32_DRIVERS_GPIO_H_
 
-#include "..\..\std_types.h"
+#include "../../std_types.h"
 
 /*******************************************************************************
  *                                Definitions                                  *
@@ -35,6 +35,14 @@
 #define PIN6_ID                6
 #define PIN7_ID                7
 
+/*
+ * Uncomment to toggle pins by writing a one to PINx (one instruction, atomic by hardware).
+ * The ATmega32 PINx registers are read-only, so keep it disabled on the ATmega32 itself;
+ * it is only for the pin-compatible parts that support it (ATmega164/324/644).
+ * When disabled the toggle is done by an interrupt-safe read-modify-write on PORTx.
+ */
+//#define GPIO_PINX_TOGGLE
+
 /*******************************************************************************
  *                               Sayed Definitions                             *
  *******************************************************************************/
@@ -86,6 +94,21 @@ typedef enum {
     PORT_INPUT, PORT_OUTPUT = 0xFF
 } GPIO_PortDirectionType;
 
+/*
+ * A group of up to GPIO_GROUP_MAX_PINS pins that are written together.
+ * Bit i of the value written to the group drives the i-th pin of the list given
+ * to GPIO_setupPinGroup. The per-port masks and the bit-scatter table are
+ * computed once, so a group write costs one masked read-modify-write per port.
+ */
+#define GPIO_GROUP_MAX_PINS    8
+
+typedef struct {
+    uint8 pin_count;                          /* number of pins in the group */
+    uint8 port_mask[NUM_OF_PORTS];            /* pins of the group in each port */
+    uint8 bit_port[GPIO_GROUP_MAX_PINS];      /* port of the pin driven by value bit i */
+    uint8 bit_mask[GPIO_GROUP_MAX_PINS];      /* mask of the pin driven by value bit i */
+} GPIO_PinGroup;
+
 /*******************************************************************************
  *                              Functions Prototypes                           *
  *******************************************************************************/
@@ -141,4 +164,53 @@ void GPIO_enablePullUp(uint8 pin_num);
 
 void GPIO_disablePullUp(uint8 pin_num);
 
+/*
+ * Description :
+ * Build the port masks and the bit-scatter table of a pin group.
+ * pins[i] is the pin driven by bit i of the values written to the group.
+ * Invalid pin numbers are ignored and at most GPIO_GROUP_MAX_PINS pins are used.
+ */
+void GPIO_setupPinGroup(GPIO_PinGroup *group, const uint8 *pins, uint8 pin_count);
+
+/*
+ * Description :
+ * Setup the direction of all the pins of the group input/output.
+ */
+void GPIO_setupPinGroupDirection(const GPIO_PinGroup *group, GPIO_PinDirectionType direction);
+
+/*
+ * Description :
+ * Write the value on the pins of the group, bit i of the value goes to the i-th pin.
+ * Each port touched by the group is updated with a single read-modify-write, so the
+ * pins of the same port change together without intermediate states.
+ */
+void GPIO_writePinGroup(const GPIO_PinGroup *group, uint8 value);
+
+/*
+ * Description :
+ * Interrupt-safe versions of the pin/port writes.
+ * The read-modify-write on PORTx is done with the global interrupts disabled and SREG
+ * restored afterwards, so an ISR writing another pin of the same port can not lose
+ * its update. If the input port number or pin number are not correct, the functions
+ * will not handle the request.
+ */
+void GPIO_setPinAtomic(uint8 pin_num);
+
+void GPIO_clearPinAtomic(uint8 pin_num);
+
+void GPIO_togglePin(uint8 pin_num);
+
+/*
+ * Description :
+ * Setup the direction of the required pin input/output, interrupt-safe.
+ */
+void GPIO_setupPinDirectionAtomic(uint8 pin_num, GPIO_PinDirectionType direction);
+
+/*
+ * Description :
+ * Replace the bits selected by the mask in the port output register with the same bits
+ * of the value, interrupt-safe.
+ */
+void GPIO_modifyPortAtomic(uint8 port_num, uint8 mask, uint8 value);
+
 #endif /* ATMEGA32_DRIVERS_GPIO_H_ */
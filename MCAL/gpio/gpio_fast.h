@@ -0,0 +1,192 @@
+/******************************************************************************
+ *
+ * Module: MCAL/GPIO
+ *
+ * File Name: gpio_fast.h
+ *
+ * Description: Header-only compile-time pin layer for the AVR GPIO driver
+ *
+ * Author: Mohamed Sayed
+ *
+ *******************************************************************************/
+
+#ifndef ATMEGA32_DRIVERS_GPIO_FAST_H_
+#define ATMEGA32_DRIVERS_GPIO_FAST_H_
+
+#include "gpio.h"
+#include "../../common_macros.h"
+#include "../Atmega32_Registers.h"
+
+/*******************************************************************************
+ *                                Description                                  *
+ *******************************************************************************
+ * The functions in this header take the same A0..D7 pin IDs as gpio.h, but they
+ * are always inlined, so when the pin ID is a constant the compiler resolves the
+ * port register and the bit mask at compile time:
+ *
+ *     GPIO_writePinFast(A3, LOGIC_HIGH);   ->  sbi PORTA, 3
+ *     GPIO_writePinFast(A3, LOGIC_LOW);    ->  cbi PORTA, 3
+ *     GPIO_readPinFast(D2)                 ->  sbis/sbic PIND, 2 (or in + andi)
+ *
+ * This needs optimization enabled (-Os / -O1 or higher, the usual AVR setting).
+ * When the pin ID is only known at run time the functions still work, but then
+ * the functions in gpio.c are the smaller choice and should be used instead.
+ *
+ * Cost per call, ESTIMATES (not measured on the target): the gpio_fast.h column
+ * is the data sheet timing of the single instruction a constant pin compiles to,
+ * the gpio.c column is an estimate of the avr-gcc -Os code, call/return included,
+ * and varies with the compiler version and the pin. Time both with the profiler
+ * (profiler.h, Benchmarks/benchmark.c) before relying on the exact numbers:
+ *
+ *  -----------------------------------------------------------------
+ *  Operation               |  gpio.c (runtime)  |  gpio_fast.h       |
+ *  -----------------------------------------------------------------
+ *  write pin               |  ~40 - 55 cycles   |  2 cycles (sbi/cbi)|
+ *  read pin                |  ~35 - 45 cycles   |  2 - 3 cycles      |
+ *  setup pin direction     |  ~40 - 55 cycles   |  2 cycles (sbi/cbi)|
+ *  -----------------------------------------------------------------
+ *
+ * The runtime path pays for the call, the pin_num / 8 and pin_num % 8 split, the
+ * four way switch and a variable (1 << pin) shift loop of up to 8 iterations.
+ *
+ * With a constant pin, the single sbi/cbi is atomic, so GPIO_writePinFast and
+ * GPIO_setupPinDirectionFast are also safe against ISRs writing the same port.
+ *******************************************************************************/
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Force inlining so the constant pin ID can be folded in every call site */
+#define GPIO_FAST_INLINE static inline __attribute__((always_inline))
+
+/*
+ * Used only to report a constant pin ID that is out of range at compile time.
+ * It is never defined, so any call that survives optimization breaks the build.
+ */
+extern void GPIO_fastInvalidPin(void) __attribute__((error("GPIO pin ID must be in the range A0..D7")));
+
+/*******************************************************************************
+ *                              Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return the PORTx register of the required pin.
+ */
+GPIO_FAST_INLINE volatile uint8* GPIO_portRegister(uint8 pin_num) {
+	if (__builtin_constant_p(pin_num) && (pin_num > D7)) {
+		GPIO_fastInvalidPin();
+	}
+	switch (pin_num / NUM_OF_PINS_PER_PORT) {
+	case PORTA_ID:
+		return &PORTA;
+	case PORTB_ID:
+		return &PORTB;
+	case PORTC_ID:
+		return &PORTC;
+	default:
+		return &PORTD;
+	}
+}
+
+/*
+ * Description :
+ * Return the DDRx register of the required pin.
+ */
+GPIO_FAST_INLINE volatile uint8* GPIO_ddrRegister(uint8 pin_num) {
+	if (__builtin_constant_p(pin_num) && (pin_num > D7)) {
+		GPIO_fastInvalidPin();
+	}
+	switch (pin_num / NUM_OF_PINS_PER_PORT) {
+	case PORTA_ID:
+		return &DDRA;
+	case PORTB_ID:
+		return &DDRB;
+	case PORTC_ID:
+		return &DDRC;
+	default:
+		return &DDRD;
+	}
+}
+
+/*
+ * Description :
+ * Return the PINx register of the required pin.
+ */
+GPIO_FAST_INLINE volatile uint8* GPIO_pinRegister(uint8 pin_num) {
+	if (__builtin_constant_p(pin_num) && (pin_num > D7)) {
+		GPIO_fastInvalidPin();
+	}
+	switch (pin_num / NUM_OF_PINS_PER_PORT) {
+	case PORTA_ID:
+		return &PINA;
+	case PORTB_ID:
+		return &PINB;
+	case PORTC_ID:
+		return &PINC;
+	default:
+		return &PIND;
+	}
+}
+
+/*
+ * Description :
+ * Return the bit mask of the required pin inside its port.
+ */
+GPIO_FAST_INLINE uint8 GPIO_pinMask(uint8 pin_num) {
+	return (uint8) (1 << (pin_num % NUM_OF_PINS_PER_PORT));
+}
+
+/*
+ * Description :
+ * Compile-time version of GPIO_setupPinDirection.
+ */
+GPIO_FAST_INLINE void GPIO_setupPinDirectionFast(uint8 pin_num,
+		GPIO_PinDirectionType direction) {
+	if (direction == PIN_OUTPUT) {
+		*GPIO_ddrRegister(pin_num) |= GPIO_pinMask(pin_num);
+	} else {
+		*GPIO_ddrRegister(pin_num) &= (uint8) ~GPIO_pinMask(pin_num);
+	}
+}
+
+/*
+ * Description :
+ * Compile-time version of GPIO_writePin.
+ * If the pin is input, this function will enable/disable the internal pull-up resistor.
+ */
+GPIO_FAST_INLINE void GPIO_writePinFast(uint8 pin_num, uint8 value) {
+	if (value == LOGIC_HIGH) {
+		*GPIO_portRegister(pin_num) |= GPIO_pinMask(pin_num);
+	} else {
+		*GPIO_portRegister(pin_num) &= (uint8) ~GPIO_pinMask(pin_num);
+	}
+}
+
+/*
+ * Description :
+ * Compile-time version of GPIO_readPin, returns Logic High or Logic Low.
+ */
+GPIO_FAST_INLINE uint8 GPIO_readPinFast(uint8 pin_num) {
+	return (*GPIO_pinRegister(pin_num) & GPIO_pinMask(pin_num)) ?
+			LOGIC_HIGH : LOGIC_LOW;
+}
+
+/*
+ * Description :
+ * Compile-time version of GPIO_togglePin, interrupt-safe.
+ */
+GPIO_FAST_INLINE void GPIO_togglePinFast(uint8 pin_num) {
+#if defined (GPIO_PINX_TOGGLE)
+	*GPIO_pinRegister(pin_num) = GPIO_pinMask(pin_num);
+#else
+	uint8 sreg = SREG;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	*GPIO_portRegister(pin_num) ^= GPIO_pinMask(pin_num);
+	SREG = sreg;
+#endif
+}
+
+#endif /* ATMEGA32_DRIVERS_GPIO_FAST_H_ */
@@ -0,0 +1,57 @@
+/**
+ * @file test.h
+ * @brief Minimal assertion helpers for the host tests.
+ *
+ * The tests are built with HOST_BUILD against the register model of
+ * MCAL/Host_Model and run on the build machine, see the Makefile at the top of
+ * the tree (make test). Every test program returns 0 when all its checks pass,
+ * so make stops at the first failing program.
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#ifndef ATMEGA32_DRIVERS_TEST_H_
+#define ATMEGA32_DRIVERS_TEST_H_
+
+#include <stdio.h>
+
+static unsigned int test_checks = 0;
+static unsigned int test_failures = 0;
+
+/* Check a condition, print the location and the expression when it is false */
+#define TEST_ASSERT(CONDITION) \
+	do { \
+		test_checks++; \
+		if (!(CONDITION)) { \
+			test_failures++; \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #CONDITION); \
+		} \
+	} while (0)
+
+/* Check two integer values, print both when they differ */
+#define TEST_ASSERT_EQUAL(EXPECTED, ACTUAL) \
+	do { \
+		unsigned long long test_expected = (unsigned long long) (EXPECTED); \
+		unsigned long long test_actual = (unsigned long long) (ACTUAL); \
+		test_checks++; \
+		if (test_expected != test_actual) { \
+			test_failures++; \
+			printf("%s:%d: %s expected %llu, got %llu\n", __FILE__, __LINE__, \
+					#ACTUAL, test_expected, test_actual); \
+		} \
+	} while (0)
+
+/* Run one test function and print its name */
+#define TEST_RUN(FUNCTION) \
+	do { \
+		printf("  %s\n", #FUNCTION); \
+		FUNCTION(); \
+	} while (0)
+
+/* Summary line and exit code of the test program */
+#define TEST_END() \
+	(printf("%u checks, %u failed\n", test_checks, test_failures), \
+			(test_failures == 0) ? 0 : 1)
+
+#endif /* ATMEGA32_DRIVERS_TEST_H_ */
@@ -0,0 +1,58 @@
+/**
+ * @file test_format.c
+ * @brief Host tests of the printf-style formatter.
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#include <string.h>
+#include "test.h"
+#include "../format.h"
+
+static char output[64];
+static uint8 output_length;
+
+static void sink(uint8 character) {
+	if (output_length < (sizeof(output) - 1)) {
+		output[output_length++] = (char) character;
+		output[output_length] = '\0';
+	}
+}
+
+#define FORMAT_CHECK(EXPECTED, ...) \
+	do { \
+		output_length = 0; \
+		output[0] = '\0'; \
+		FORMAT_print(sink, __VA_ARGS__); \
+		TEST_ASSERT(strcmp(output, (EXPECTED)) == 0); \
+		if (strcmp(output, (EXPECTED)) != 0) { \
+			printf("    got \"%s\"\n", output); \
+		} \
+	} while (0)
+
+static void test_conversions(void) {
+	FORMAT_CHECK("42|-7|+3", "%u|%d|%+d", 42, -7, 3);
+	FORMAT_CHECK("00ff|FF", "%04x|%X", 0xFF, 0xFF);
+	FORMAT_CHECK("12.34|-0.05", "%q|%.2q", 1234, -5);
+	FORMAT_CHECK("4294967295", "%lu", (uint32) 0xFFFFFFFFUL);
+	FORMAT_CHECK("-2147483648", "%ld", (sint32) (-2147483647L - 1));
+	FORMAT_CHECK("ab  |", "%-4s|", "ab");
+}
+
+/* '*' fields, a negative width left aligns as in printf */
+static void test_star_fields(void) {
+	FORMAT_CHECK("   12|", "%*u|", 5, 12);
+	FORMAT_CHECK("12   |", "%*u|", -5, 12);
+	FORMAT_CHECK("ab   |", "%*s|", -5, "ab");
+	FORMAT_CHECK("1.234", "%.*q", 3, 1234);
+	/* Negative precision: the default 2 decimals */
+	FORMAT_CHECK("12.34", "%.*q", -1, 1234);
+}
+
+int main(void) {
+	printf("test_format\n");
+	TEST_RUN(test_conversions);
+	TEST_RUN(test_star_fields);
+	return TEST_END();
+}
@@ -0,0 +1,72 @@
+/**
+ * @file test_frame.c
+ * @brief Host tests of the frame receiver counters.
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#include "test.h"
+#include "../HAL/Frame_Transport/frame.h"
+
+#define PAYLOAD_SIZE 4
+
+static uint8 receive_buffer[FRAME_RECEIVE_SIZE(PAYLOAD_SIZE)];
+static FRAME_Receiver receiver;
+
+/* Feed the wire bytes of one frame, return TRUE if it came out valid */
+static boolean feed_frame(uint8 seq) {
+	const uint8 payload[PAYLOAD_SIZE] = { 0x01, 0x00, 0x7F, 0xFF };
+	uint8 wire[FRAME_ENCODED_SIZE(PAYLOAD_SIZE)];
+	const uint8 *received;
+	uint8 received_seq;
+	uint16 length = FRAME_encode(seq, payload, PAYLOAD_SIZE, wire);
+	uint16 i;
+	FRAME_Status status = FRAME_ACCEPTED;
+
+	for (i = 0; i < length; i++) {
+		status = FRAME_feed(&receiver, wire[i]);
+	}
+	if (status != FRAME_READY) {
+		return FALSE;
+	}
+	length = FRAME_getPayload(&receiver, &received, &received_seq);
+	FRAME_release(&receiver);
+	return (length == PAYLOAD_SIZE) && (received_seq == seq);
+}
+
+/* Skipped numbers are lost frames, a repeated one is not */
+static void test_lost_and_duplicate_frames(void) {
+	FRAME_initReceiver(&receiver, receive_buffer, sizeof(receive_buffer));
+	TEST_ASSERT(feed_frame(0));
+	TEST_ASSERT(feed_frame(1));
+	TEST_ASSERT(feed_frame(1));
+	TEST_ASSERT_EQUAL(0, FRAME_getLostFrameCount(&receiver));
+	TEST_ASSERT(feed_frame(2));
+	TEST_ASSERT(feed_frame(5));
+	TEST_ASSERT_EQUAL(2, FRAME_getLostFrameCount(&receiver));
+	/* Wrap of the 8-bit numbers */
+	TEST_ASSERT(feed_frame(255));
+	TEST_ASSERT(feed_frame(0));
+	TEST_ASSERT_EQUAL(2 + 249, FRAME_getLostFrameCount(&receiver));
+}
+
+/* The lost frame counter stops at 0xFFFF */
+static void test_lost_frames_saturate(void) {
+	uint16 i;
+
+	FRAME_initReceiver(&receiver, receive_buffer, sizeof(receive_buffer));
+	TEST_ASSERT(feed_frame(0));
+	/* 254 lost frames per step */
+	for (i = 0; i < 300; i++) {
+		TEST_ASSERT(feed_frame((uint8) ((i + 1) * 255)));
+	}
+	TEST_ASSERT_EQUAL(0xFFFF, FRAME_getLostFrameCount(&receiver));
+}
+
+int main(void) {
+	printf("test_frame\n");
+	TEST_RUN(test_lost_and_duplicate_frames);
+	TEST_RUN(test_lost_frames_saturate);
+	return TEST_END();
+}
@@ -0,0 +1,130 @@
+/**
+ * @file test_gpio_atomic.c
+ * @brief ISR against main loop stress test of the interrupt-safe GPIO writes.
+ *
+ * The Timer0 overflow ISR toggles A7 while the main loop hammers the other pins
+ * of PORTA with GPIO_setPinAtomic, GPIO_clearPinAtomic and GPIO_modifyPortAtomic.
+ * The host model runs the ISR between any two register accesses of the main
+ * line, so an unprotected PORTA read-modify-write loses ISR toggles; the control
+ * case checks that the test really hits that window.
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#include "test.h"
+#include "../MCAL/gpio/gpio.h"
+#include "../MCAL/Host_Model/host_model.h"
+#include "../MCAL/Atmega32_Registers.h"
+
+#define STRESS_ITERATIONS 20000
+
+/* Pin owned by the ISR, the main loop uses the other PORTA pins */
+#define ISR_PIN      A7
+#define ISR_PIN_MASK (1 << 7)
+
+/* Timer0 overflow interrupt */
+#define TIMER0_OVF_ISR __vector_11
+
+void TIMER0_OVF_ISR(void)__attribute__((signal, used, externally_visible));
+
+static volatile uint16 isr_toggles;
+
+void TIMER0_OVF_ISR(void) {
+	GPIO_togglePin(ISR_PIN);
+	isr_toggles++;
+}
+
+/* Timer0 normal mode, no prescaler: an overflow every 256 cycles */
+static void start_isr_load(void) {
+	HOST_reset();
+	GPIO_setupPortDirection(PORTA_ID, PORT_OUTPUT);
+	GPIO_writePort(PORTA_ID, 0x00);
+	isr_toggles = 0;
+	TCCR0 = 0x01; /* CS02:0 = 001 */
+	TIMSK = 0x01; /* TOIE0 */
+	GLOBAL_INTERRUPT_ENABLE();
+}
+
+static void stop_isr_load(void) {
+	GLOBAL_INTERRUPT_DISABLE();
+	TIMSK = 0;
+	TCCR0 = 0;
+}
+
+/* The ISR pin must follow the number of toggles done by the ISR */
+static boolean isr_pin_consistent(void) {
+	uint8 sreg = SREG;
+	boolean consistent;
+
+	GLOBAL_INTERRUPT_DISABLE();
+	consistent = ((PORTA & ISR_PIN_MASK) != 0) == ((isr_toggles & 1) != 0);
+	SREG = sreg;
+	return consistent;
+}
+
+static void test_set_clear_atomic(void) {
+	uint16 i;
+	uint16 lost = 0;
+
+	start_isr_load();
+	for (i = 0; i < STRESS_ITERATIONS; i++) {
+		if (i & 1) {
+			GPIO_clearPinAtomic(A0);
+		} else {
+			GPIO_setPinAtomic(A0);
+		}
+		if (!isr_pin_consistent()) {
+			lost++;
+		}
+	}
+	stop_isr_load();
+	TEST_ASSERT(isr_toggles > 100);
+	TEST_ASSERT_EQUAL(0, lost);
+	TEST_ASSERT_EQUAL(0, PORTA & 0x01);
+}
+
+static void test_modify_port_atomic(void) {
+	uint16 i;
+	uint16 lost = 0;
+
+	start_isr_load();
+	for (i = 0; i < STRESS_ITERATIONS; i++) {
+		GPIO_modifyPortAtomic(PORTA_ID, 0x7F, (uint8) i);
+		if (!isr_pin_consistent()) {
+			lost++;
+		}
+	}
+	stop_isr_load();
+	TEST_ASSERT(isr_toggles > 100);
+	TEST_ASSERT_EQUAL(0, lost);
+	TEST_ASSERT_EQUAL((STRESS_ITERATIONS - 1) & 0x7F, PORTA & 0x7F);
+}
+
+/* Control: the same writes without the critical section do lose toggles */
+static void test_unprotected_read_modify_write(void) {
+	uint16 i;
+	uint16 lost = 0;
+	uint8 value;
+
+	start_isr_load();
+	for (i = 0; i < STRESS_ITERATIONS; i++) {
+		value = PORTA;
+		PORTA = (uint8) ((value & ~0x01) | (i & 1));
+		if (!isr_pin_consistent()) {
+			lost++;
+			/* Put the pin back in step so every lost update is counted once */
+			GPIO_togglePin(ISR_PIN);
+		}
+	}
+	stop_isr_load();
+	TEST_ASSERT(lost > 0);
+}
+
+int main(void) {
+	printf("test_gpio_atomic\n");
+	TEST_RUN(test_set_clear_atomic);
+	TEST_RUN(test_modify_port_atomic);
+	TEST_RUN(test_unprotected_read_modify_write);
+	return TEST_END();
+}
@@ -0,0 +1,380 @@
+/**
+ * @file test_host_model.c
+ * @brief Regression test of the drivers running on the host register model.
+ *
+ * Drives GPIO, UART, SPI and TWI through MCAL/Host_Model and checks both the
+ * behavior (pins, bytes on the wires, status codes) and the cost accounting of
+ * the model (register accesses and simulated cycles), so a change that breaks a
+ * driver or makes it touch the hardware more often fails here.
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#include "test.h"
+#include "../MCAL/gpio/gpio.h"
+#include "../MCAL/Communication/UART/uart.h"
+#include "../MCAL/Communication/SPI/spi.h"
+#include "../MCAL/Communication/I2C/twi.h"
+#include "../MCAL/Host_Model/host_model.h"
+#include "../MCAL/Atmega32_Registers.h"
+
+/*******************************************************************************
+ *                      Simulated peers                                        *
+ *******************************************************************************/
+
+/* SPI device answering every byte with its complement */
+static uint8 spi_peer(uint8 mosi) {
+	return (uint8) ~mosi;
+}
+
+/* 24C-like memory on the TWI bus: first written byte is the address pointer */
+#define MEMORY_ADDRESS 0x50
+
+static uint8 memory[256];
+static uint8 memory_pointer;
+static boolean memory_pointer_next;
+static uint8 memory_stops;
+
+static boolean memory_start(boolean read) {
+	if (!read) {
+		memory_pointer_next = TRUE;
+	}
+	return TRUE;
+}
+
+static boolean memory_write(uint8 data) {
+	if (memory_pointer_next) {
+		memory_pointer_next = FALSE;
+		memory_pointer = data;
+	} else {
+		memory[memory_pointer++] = data;
+	}
+	return TRUE;
+}
+
+static uint8 memory_read(void) {
+	return memory[memory_pointer++];
+}
+
+static void memory_stop(void) {
+	memory_stops++;
+}
+
+static const HOST_TwiSlave memory_device = { MEMORY_ADDRESS, memory_start,
+		memory_write, memory_read, memory_stop };
+
+static uint8 twi_callbacks;
+
+static void twi_done(TWI_Transaction *transaction) {
+	(void) transaction;
+	twi_callbacks++;
+}
+
+/*******************************************************************************
+ *                      Tests                                                  *
+ *******************************************************************************/
+
+/* The host build must see the integer widths of the target */
+static void test_integer_widths(void) {
+	uint32 wrap = 0xFFFFFFFFUL;
+	sint32 negative = -1;
+
+	TEST_ASSERT_EQUAL(1, sizeof(uint8));
+	TEST_ASSERT_EQUAL(2, sizeof(uint16));
+	TEST_ASSERT_EQUAL(4, sizeof(uint32));
+	TEST_ASSERT_EQUAL(4, sizeof(sint32));
+	TEST_ASSERT_EQUAL(8, sizeof(uint64));
+	wrap++;
+	TEST_ASSERT_EQUAL(0, wrap);
+	TEST_ASSERT_EQUAL(0xFFFFFFFFUL, (uint32) negative);
+}
+
+static void test_gpio_output_and_input(void) {
+	HOST_reset();
+	GPIO_setupPinDirection(A3, PIN_OUTPUT);
+	GPIO_writePin(A3, LOGIC_HIGH);
+	TEST_ASSERT_EQUAL(1 << 3, DDRA);
+	TEST_ASSERT_EQUAL(1 << 3, PORTA);
+	TEST_ASSERT_EQUAL(LOGIC_HIGH, GPIO_readPin(A3));
+
+	GPIO_setupPinDirection(D2, PIN_INPUT);
+	HOST_setPin(D2, LOGIC_HIGH);
+	TEST_ASSERT_EQUAL(LOGIC_HIGH, GPIO_readPin(D2));
+	HOST_setPin(D2, LOGIC_LOW);
+	TEST_ASSERT_EQUAL(LOGIC_LOW, GPIO_readPin(D2));
+
+	GPIO_setupPortDirection(PORTB_ID, PORT_OUTPUT);
+	GPIO_writePort(PORTB_ID, 0xA5);
+	TEST_ASSERT_EQUAL(0xA5, GPIO_readPort(PORTB_ID));
+}
+
+static void test_gpio_cost(void) {
+	HOST_reset();
+	GPIO_setupPinDirection(C5, PIN_OUTPUT);
+
+	/* One read-modify-write of PORTC per pin write, nothing else */
+	HOST_resetAccessCounters();
+	GPIO_writePin(C5, LOGIC_HIGH);
+	TEST_ASSERT_EQUAL(1, HOST_getAccessCount());
+	TEST_ASSERT_EQUAL(1, HOST_getRegisterAccessCount(0x35)); /* PORTC */
+
+	/* The atomic version: PORTC read and write inside the SREG save, disable, restore */
+	HOST_resetAccessCounters();
+	GPIO_setPinAtomic(C5);
+	TEST_ASSERT_EQUAL(2, HOST_getRegisterAccessCount(0x35));
+	TEST_ASSERT_EQUAL(3, HOST_getRegisterAccessCount(0x5F)); /* SREG */
+	TEST_ASSERT_EQUAL(5, HOST_getAccessCount());
+}
+
+static void test_uart_polling(void) {
+	uint8 received[8];
+	uint16 count;
+	uint64 start;
+
+	HOST_reset();
+	UART_init(9600);
+
+	/* 8N1 at 9600 baud: a byte on the wire lasts 10 bits */
+	start = HOST_getCycles();
+	UART_sendString((const uint8*) "OK");
+	HOST_advanceCycles(2 * 10 * (F_CPU / 9600));
+	count = HOST_uartTake(received, sizeof(received));
+	TEST_ASSERT_EQUAL(2, count);
+	TEST_ASSERT(received[0] == 'O' && received[1] == 'K');
+	/* The second byte waits in UDR while the first one is shifted out */
+	TEST_ASSERT(HOST_getCycles() - start >= 2 * 10 * (F_CPU / 9600));
+
+	HOST_uartInject((const uint8*) "Z", 1);
+	TEST_ASSERT_EQUAL('Z', UART_recieveByte());
+}
+
+static void test_uart_interrupt(void) {
+	uint8 received[16];
+	uint16 count;
+
+	HOST_reset();
+	UART_initInterrupt(115200);
+	GLOBAL_INTERRUPT_ENABLE();
+
+	TEST_ASSERT_EQUAL(6, UART_write((const uint8*) "hello\n", 6));
+	HOST_advanceCycles(6 * 10 * (F_CPU / 115200) + 1000);
+	count = HOST_uartTake(received, sizeof(received));
+	TEST_ASSERT_EQUAL(6, count);
+	TEST_ASSERT(received[0] == 'h' && received[5] == '\n');
+
+	HOST_uartInject((const uint8*) "abc", 3);
+	HOST_advanceCycles(3 * 10 * (F_CPU / 115200) + 1000);
+	count = UART_read(received, sizeof(received));
+	TEST_ASSERT_EQUAL(3, count);
+	TEST_ASSERT(received[0] == 'a' && received[2] == 'c');
+	GLOBAL_INTERRUPT_DISABLE();
+}
+
+/* UART_init after the interrupt or multi-drop init goes back to polling */
+static void test_uart_init_after_interrupt_mode(void) {
+	const UART_MultidropConfig config = { 0x12, UART_NO_DE_PIN };
+	uint8 received[4];
+
+	HOST_reset();
+	UART_initInterrupt(9600);
+	UART_init(9600);
+	/* Interrupts stay disabled, only the polled path can move the bytes */
+	TEST_ASSERT_EQUAL(1, UART_write((const uint8*) "P", 1));
+	HOST_advanceCycles(10 * (F_CPU / 9600) + 100);
+	TEST_ASSERT_EQUAL(1, HOST_uartTake(received, sizeof(received)));
+	HOST_uartInject((const uint8*) "Q", 1);
+	HOST_advanceCycles(10 * (F_CPU / 9600) + 100);
+	TEST_ASSERT_EQUAL(1, UART_read(received, sizeof(received)));
+	TEST_ASSERT_EQUAL('Q', received[0]);
+
+	UART_initMultidrop(9600, &config);
+	UART_init(9600);
+	TEST_ASSERT_EQUAL(0, UCSRB & (1 << UCSZ2));
+	HOST_uartInject((const uint8*) "R", 1);
+	HOST_advanceCycles(10 * (F_CPU / 9600) + 100);
+	TEST_ASSERT_EQUAL(1, UART_read(received, sizeof(received)));
+	TEST_ASSERT_EQUAL('R', received[0]);
+}
+
+static void test_spi_master(void) {
+	const SPI_Config config = { SPI_FCPU_4, SPI_MODE_0, SPI_MSB };
+	const uint8 tx[4] = { 0x00, 0x01, 0x80, 0xFF };
+	uint8 rx[4];
+	uint64 start;
+
+	HOST_reset();
+	HOST_spiSetPeer(spi_peer);
+	SPI_initMaster(&config);
+
+	TEST_ASSERT_EQUAL(0xA5, sendReceiveByte(0x5A));
+
+	start = HOST_getCycles();
+	SPI_transfer(tx, rx, 4);
+	TEST_ASSERT(rx[0] == 0xFF && rx[1] == 0xFE && rx[2] == 0x7F && rx[3] == 0x00);
+	/* 8 SCK periods of 4 cycles per byte is the lower bound */
+	TEST_ASSERT(HOST_getCycles() - start >= 4 * 8 * 4);
+}
+
+static void test_spi_queue(void) {
+	const SPI_Device device = { B3, { SPI_FCPU_16, SPI_MODE_0, SPI_MSB } };
+	const uint8 tx[3] = { 1, 2, 3 };
+	uint8 rx[3];
+	SPI_Transaction transaction = { &device, tx, rx, 3, NULL_PTR };
+
+	HOST_reset();
+	HOST_spiSetPeer(spi_peer);
+	SPI_initMaster(&device.config);
+	SPI_initDevice(&device);
+	GLOBAL_INTERRUPT_ENABLE();
+
+	TEST_ASSERT(SPI_submit(&transaction));
+	while (SPI_isBusy()) {
+		HOST_advanceCycles(16);
+	}
+	TEST_ASSERT(rx[0] == 0xFE && rx[1] == 0xFD && rx[2] == 0xFC);
+	/* Chip select released after the transaction */
+	TEST_ASSERT_EQUAL(LOGIC_HIGH, GPIO_readPin(B3));
+	GLOBAL_INTERRUPT_DISABLE();
+}
+
+/* SPI slave register map written and read by a frame longer than 256 bytes */
+static struct {
+	uint8 before[4];
+	uint8 map[8];
+	uint8 after[4];
+} spi_registers;
+static uint8 spi_write_first;
+static uint8 spi_write_count;
+
+static void spi_register_write(uint8 address, uint8 count) {
+	spi_write_first = address;
+	spi_write_count = count;
+}
+
+static void spi_select(uint8 level) {
+	/* SS on PB4, its edges reach the driver through INT0 (PD2) */
+	HOST_setPin(B4, level);
+	HOST_setPin(D2, level);
+	HOST_advanceCycles(16);
+}
+
+static void test_spi_slave_register_map_bounds(void) {
+	const SPI_SlaveConfig config = { SPI_MODE_0, SPI_MSB, EXTI_INT0 };
+	uint16 i;
+	uint16 inside = 0;
+	uint8 miso;
+
+	HOST_reset();
+	HOST_setPin(B4, LOGIC_HIGH);
+	HOST_setPin(D2, LOGIC_HIGH);
+	for (i = 0; i < sizeof(spi_registers.map); i++) {
+		spi_registers.map[i] = 0;
+		spi_registers.before[i & 3] = 0;
+		spi_registers.after[i & 3] = 0;
+	}
+	SPI_initSlaveInterrupt(&config);
+	SPI_slaveSetRegisterMap(spi_registers.map, sizeof(spi_registers.map),
+			spi_register_write);
+	GLOBAL_INTERRUPT_ENABLE();
+
+	/* Write frame from register 0, 300 bytes: only the 8 registers change */
+	spi_select(LOGIC_LOW);
+	(void) HOST_spiMasterTransfer(0x00);
+	for (i = 0; i < 300; i++) {
+		(void) HOST_spiMasterTransfer((uint8) (0x80 | i));
+	}
+	spi_select(LOGIC_HIGH);
+	for (i = 0; i < 4; i++) {
+		TEST_ASSERT_EQUAL(0, spi_registers.before[i]);
+		TEST_ASSERT_EQUAL(0, spi_registers.after[i]);
+	}
+	TEST_ASSERT_EQUAL(0x80, spi_registers.map[0]);
+	TEST_ASSERT_EQUAL(0x87, spi_registers.map[7]);
+	TEST_ASSERT_EQUAL(0, spi_write_first);
+	TEST_ASSERT_EQUAL(8, spi_write_count);
+
+	/* Read frame from register 6, 300 bytes: 6 and 7, then only fill bytes */
+	spi_select(LOGIC_LOW);
+	(void) HOST_spiMasterTransfer(SPI_REG_READ | 6);
+	for (i = 0; i < 300; i++) {
+		miso = HOST_spiMasterTransfer(SPI_FILL_BYTE);
+		if (miso != SPI_FILL_BYTE) {
+			inside++;
+		}
+		if (i == 0) {
+			TEST_ASSERT_EQUAL(0x86, miso);
+		}
+	}
+	spi_select(LOGIC_HIGH);
+	TEST_ASSERT_EQUAL(2, inside);
+	GLOBAL_INTERRUPT_DISABLE();
+}
+
+static void test_twi_blocking(void) {
+	TWI_ConfigType config = { 0x01, SCL_400kbit };
+	const uint8 data[3] = { 0x11, 0x22, 0x33 };
+	uint8 read_back[3];
+
+	HOST_reset();
+	HOST_twiAttachSlave(&memory_device);
+	TWI_init(&config);
+	memory_stops = 0;
+
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, TWI_writeRegs(MEMORY_ADDRESS, 0x40, data, 3));
+	TEST_ASSERT(memory[0x40] == 0x11 && memory[0x42] == 0x33);
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, TWI_readRegs(MEMORY_ADDRESS, 0x40, read_back, 3));
+	TEST_ASSERT(read_back[0] == 0x11 && read_back[2] == 0x33);
+	/* STOP of the write, repeated START and STOP of the read */
+	TEST_ASSERT_EQUAL(3, memory_stops);
+
+	/* Nobody answers this address */
+	TEST_ASSERT_EQUAL(TWI_RESULT_ADDRESS_NACK,
+			TWI_transfer(0x51, data, 1, NULL_PTR, 0));
+}
+
+static void test_twi_queue(void) {
+	TWI_ConfigType config = { 0x01, SCL_400kbit };
+	uint8 write_data[2] = { 0x10, 0xC3 };
+	uint8 pointer = 0x10;
+	uint8 read_data;
+	TWI_Transaction write = { .address = MEMORY_ADDRESS, .write_data = write_data,
+			.write_length = 2, .callback = twi_done };
+	TWI_Transaction read = { .address = MEMORY_ADDRESS, .write_data = &pointer,
+			.write_length = 1, .read_data = &read_data, .read_length = 1,
+			.repeated_start = TRUE, .callback = twi_done };
+
+	HOST_reset();
+	HOST_twiAttachSlave(&memory_device);
+	TWI_init(&config);
+	GLOBAL_INTERRUPT_ENABLE();
+	twi_callbacks = 0;
+
+	TEST_ASSERT(TWI_submit(&write));
+	TEST_ASSERT(TWI_submit(&read));
+	TEST_ASSERT_EQUAL(2, TWI_getPendingTransactions());
+	while (TWI_isBusy()) {
+		HOST_advanceCycles(16);
+	}
+	TEST_ASSERT_EQUAL(2, twi_callbacks);
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, write.result);
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, read.result);
+	TEST_ASSERT_EQUAL(0xC3, read_data);
+	GLOBAL_INTERRUPT_DISABLE();
+}
+
+int main(void) {
+	printf("test_host_model\n");
+	TEST_RUN(test_integer_widths);
+	TEST_RUN(test_gpio_output_and_input);
+	TEST_RUN(test_gpio_cost);
+	TEST_RUN(test_uart_polling);
+	TEST_RUN(test_uart_interrupt);
+	TEST_RUN(test_uart_init_after_interrupt_mode);
+	TEST_RUN(test_spi_master);
+	TEST_RUN(test_spi_queue);
+	TEST_RUN(test_spi_slave_register_map_bounds);
+	TEST_RUN(test_twi_blocking);
+	TEST_RUN(test_twi_queue);
+	return TEST_END();
+}
@@ -0,0 +1,326 @@
+/**
+ * @file test_twi.c
+ * @brief Host tests of the TWI timeouts, bus recovery and slave/master sharing.
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#include "test.h"
+#include "../MCAL/Communication/I2C/twi.h"
+#include "../MCAL/gpio/gpio.h"
+#include "../MCAL/Host_Model/host_model.h"
+#include "../MCAL/Atmega32_Registers.h"
+
+#define DEVICE_ADDRESS 0x50
+
+/* Own slave address of the MCU, addressed by the simulated external master */
+#define OWN_ADDRESS 0x20
+#define OWN_SLA_W   (OWN_ADDRESS << 1)
+
+/* Cycles of TWI_DEFAULT_TIMEOUT_US */
+#define TIMEOUT_CYCLES ((uint32) TWI_DEFAULT_TIMEOUT_US * (F_CPU / 1000000UL))
+
+static boolean device_start(boolean read) {
+	(void) read;
+	return TRUE;
+}
+
+static const HOST_TwiSlave device = { DEVICE_ADDRESS, device_start, NULL_PTR,
+		NULL_PTR, NULL_PTR };
+
+static sint8 last_result;
+
+static uint8 registers[8];
+
+static const TWI_SlaveConfig slave_config = { OWN_ADDRESS, FALSE, registers,
+		sizeof(registers), sizeof(registers), NULL_PTR };
+
+static void transaction_done(TWI_Transaction *transaction) {
+	last_result = (sint8) transaction->result;
+}
+
+static void setup(void) {
+	TWI_ConfigType config = { 0x01, SCL_400kbit };
+
+	HOST_reset();
+	HOST_twiAttachSlave(&device);
+	TWI_init(&config);
+	last_result = -1;
+}
+
+/* A wait for a TWINT that never comes gives up after the timeout, not earlier */
+static void test_blocking_timeout_length(void) {
+	uint64 start;
+	uint64 elapsed;
+
+	setup();
+	/* Data byte without a START: the hardware never sets TWINT */
+	start = HOST_getCycles();
+	TWI_writeByte(0x11);
+	elapsed = HOST_getCycles() - start;
+	TEST_ASSERT_EQUAL(TWI_TIMEOUT, TWI_getStatus());
+	TEST_ASSERT(elapsed >= TIMEOUT_CYCLES);
+	/* The timeout plus the recovery (9 pulses at most, 5 us half periods) */
+	TEST_ASSERT(elapsed <= TIMEOUT_CYCLES + 25 * TWI_RECOVERY_HALF_PERIOD_US * (F_CPU / 1000000UL));
+
+	/* The bus works again */
+	TWI_start();
+	TEST_ASSERT_EQUAL(TWI_START, TWI_getStatus());
+	TWI_stop();
+}
+
+/* TWI_tick only flags the recovery, the main loop does the slow part */
+static void test_tick_defers_recovery(void) {
+	/* Slowest SCL: the transaction outlasts TWI_TIMEOUT_TICKS ticks of 1 ms */
+	const TWI_BitRate slowest = { 255, 3, TWI_SCL_FOR(255, 3) };
+	uint8 data[2] = { 1, 2 };
+	TWI_Transaction transaction = { .address = DEVICE_ADDRESS, .write_data = data,
+			.write_length = 2, .callback = transaction_done, .bit_rate = &slowest };
+	uint64 start;
+	uint8 tick;
+
+	setup();
+	GLOBAL_INTERRUPT_ENABLE();
+	TEST_ASSERT(TWI_submit(&transaction));
+	for (tick = 0; tick < TWI_TIMEOUT_TICKS; tick++) {
+		HOST_advanceCycles(F_CPU / 1000);
+		start = HOST_getCycles();
+		TWI_tick();
+		/* No bit-banging in the tick */
+		TEST_ASSERT(HOST_getCycles() - start < 100);
+	}
+	TEST_ASSERT_EQUAL(-1, last_result);
+	TEST_ASSERT(TWI_isBusy());
+	TEST_ASSERT_EQUAL(0, TWCR & (1 << TWIE));
+
+	TEST_ASSERT(TWI_processRecovery());
+	TEST_ASSERT_EQUAL(TWI_RESULT_TIMEOUT, last_result);
+	TEST_ASSERT(!TWI_isBusy());
+	TEST_ASSERT(!TWI_processRecovery());
+	/* Both lines released by the recovery */
+	TEST_ASSERT_EQUAL(LOGIC_HIGH, GPIO_readPin(TWI_SCL_PIN));
+	TEST_ASSERT_EQUAL(LOGIC_HIGH, GPIO_readPin(TWI_SDA_PIN));
+
+	/* The next transaction goes through at the normal rate */
+	last_result = -1;
+	transaction.bit_rate = NULL_PTR;
+	TEST_ASSERT(TWI_submit(&transaction));
+	while (TWI_isBusy()) {
+		HOST_advanceCycles(16);
+	}
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, last_result);
+	GLOBAL_INTERRUPT_DISABLE();
+}
+
+/* Write frame of the external master: register pointer 2, then 0xAB and 0xCD */
+static void external_write_frame_tail(void) {
+	TEST_ASSERT(HOST_twiMasterWrite(0xAB));
+	TEST_ASSERT(HOST_twiMasterWrite(0xCD));
+	TEST_ASSERT_EQUAL(0xAB, registers[2]);
+	TEST_ASSERT_EQUAL(0xCD, registers[3]);
+	/* Nothing sent as master in the middle of the frame */
+	TEST_ASSERT_EQUAL(-1, last_result);
+	TEST_ASSERT(TWI_isBusy());
+	HOST_twiMasterStop();
+}
+
+static void wait_transaction(void) {
+	while (TWI_isBusy()) {
+		HOST_advanceCycles(16);
+	}
+}
+
+/* A transaction submitted while this slave is addressed waits for the frame end */
+static void test_submit_while_addressed(void) {
+	uint8 data[2] = { 1, 2 };
+	TWI_Transaction transaction = { .address = DEVICE_ADDRESS, .write_data = data,
+			.write_length = 2, .callback = transaction_done };
+
+	setup();
+	TWI_initSlave(&slave_config);
+	GLOBAL_INTERRUPT_ENABLE();
+	TEST_ASSERT(HOST_twiMasterStart(OWN_SLA_W));
+	TEST_ASSERT(HOST_twiMasterWrite(2));
+	TEST_ASSERT(TWI_slaveIsAddressed());
+
+	TEST_ASSERT(TWI_submit(&transaction));
+	external_write_frame_tail();
+	wait_transaction();
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, last_result);
+	GLOBAL_INTERRUPT_DISABLE();
+	TWI_disableSlave();
+}
+
+/* Same with the SLA+W still waiting for the ISR when the transaction is submitted */
+static void test_submit_with_slave_twint_pending(void) {
+	uint8 data[2] = { 1, 2 };
+	TWI_Transaction transaction = { .address = DEVICE_ADDRESS, .write_data = data,
+			.write_length = 2, .callback = transaction_done };
+
+	setup();
+	TWI_initSlave(&slave_config);
+	/* Interrupts off: the SLA+W event stays in TWINT */
+	TEST_ASSERT(HOST_twiMasterStart(OWN_SLA_W));
+	TEST_ASSERT(TWCR & (1 << TWINT));
+	TEST_ASSERT(TWI_submit(&transaction));
+	GLOBAL_INTERRUPT_ENABLE();
+	HOST_advanceCycles(16);
+	TEST_ASSERT(TWI_slaveIsAddressed());
+
+	TEST_ASSERT(HOST_twiMasterWrite(2));
+	external_write_frame_tail();
+	wait_transaction();
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, last_result);
+	GLOBAL_INTERRUPT_DISABLE();
+	TWI_disableSlave();
+}
+
+/* The blocking functions refuse to start inside a slave frame */
+static void test_blocking_while_addressed(void) {
+	const uint8 data[2] = { 1, 2 };
+
+	setup();
+	TWI_initSlave(&slave_config);
+	GLOBAL_INTERRUPT_ENABLE();
+	TEST_ASSERT(HOST_twiMasterStart(OWN_SLA_W));
+	TEST_ASSERT(HOST_twiMasterWrite(2));
+	TEST_ASSERT_EQUAL(TWI_RESULT_BUS_ERROR,
+			TWI_writeRegs(DEVICE_ADDRESS, 0x00, data, 2));
+	TEST_ASSERT_EQUAL(TWI_RESULT_BUS_ERROR,
+			TWI_transfer(DEVICE_ADDRESS, NULL_PTR, 0, NULL_PTR, 0));
+	/* The slave frame goes on untouched */
+	TEST_ASSERT(HOST_twiMasterWrite(0xAB));
+	TEST_ASSERT_EQUAL(0xAB, registers[2]);
+	TEST_ASSERT(TWCR & (1 << TWEA));
+	HOST_twiMasterStop();
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, TWI_writeRegs(DEVICE_ADDRESS, 0x00, data, 2));
+	/* The slave answers again after the blocking transfer */
+	TEST_ASSERT(TWCR & (1 << TWEA));
+
+	/* Same with the SLA+W still waiting for the ISR */
+	GLOBAL_INTERRUPT_DISABLE();
+	TEST_ASSERT(HOST_twiMasterStart(OWN_SLA_W));
+	TEST_ASSERT_EQUAL(TWI_RESULT_BUS_ERROR,
+			TWI_transfer(DEVICE_ADDRESS, NULL_PTR, 0, NULL_PTR, 0));
+	TEST_ASSERT(TWCR & (1 << TWINT));
+	GLOBAL_INTERRUPT_ENABLE();
+	HOST_advanceCycles(16);
+	TEST_ASSERT(TWI_slaveIsAddressed());
+	TEST_ASSERT(HOST_twiMasterWrite(3));
+	TEST_ASSERT(HOST_twiMasterWrite(0xCD));
+	TEST_ASSERT_EQUAL(0xCD, registers[3]);
+	HOST_twiMasterStop();
+	GLOBAL_INTERRUPT_DISABLE();
+	TWI_disableSlave();
+}
+
+/* TWEA stays set through a master write so the own address is still answered */
+static void test_master_keeps_slave_ack(void) {
+	uint8 data[4] = { 1, 2, 3, 4 };
+	TWI_Transaction transaction = { .address = DEVICE_ADDRESS, .write_data = data,
+			.write_length = 4, .callback = transaction_done };
+	uint16 twea_clear = 0;
+
+	setup();
+	TWI_initSlave(&slave_config);
+	GLOBAL_INTERRUPT_ENABLE();
+	TEST_ASSERT(TWI_submit(&transaction));
+	while (TWI_isBusy()) {
+		if (BIT_IS_CLEAR(TWCR, TWEA)) {
+			twea_clear++;
+		}
+		HOST_advanceCycles(16);
+	}
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, last_result);
+	TEST_ASSERT_EQUAL(0, twea_clear);
+	TEST_ASSERT(TWCR & (1 << TWEA));
+	GLOBAL_INTERRUPT_DISABLE();
+	TWI_disableSlave();
+}
+
+/* Solver at F_CPU = 8 MHz: smallest prescaler, never faster than asked */
+static void test_solve_bit_rate(void) {
+	TWI_DEFINE_BIT_RATE(constant_1k, 1000UL);
+	TWI_BitRate setting;
+
+	TEST_ASSERT(TWI_solveBitRate(400000UL, &setting));
+	TEST_ASSERT_EQUAL(SCL_400kbit, setting.twbr);
+	TEST_ASSERT_EQUAL(0, setting.twps);
+	TEST_ASSERT_EQUAL(400000UL, setting.achieved_scl);
+
+	/* 8000 cycles per period: TWPS = 2, TWBR = 250 */
+	TEST_ASSERT(TWI_solveBitRate(1000UL, &setting));
+	TEST_ASSERT_EQUAL(250, setting.twbr);
+	TEST_ASSERT_EQUAL(2, setting.twps);
+	TEST_ASSERT(setting.achieved_scl <= 1000UL);
+	TEST_ASSERT_EQUAL(TWI_SCL_FOR(250, 2), setting.achieved_scl);
+
+	/* The compile-time solver gives the same setting */
+	TEST_ASSERT_EQUAL(setting.twbr, constant_1k.twbr);
+	TEST_ASSERT_EQUAL(setting.twps, constant_1k.twps);
+	TEST_ASSERT_EQUAL(setting.achieved_scl, constant_1k.achieved_scl);
+
+	/* Out of range: FALSE and the nearest limit */
+	TEST_ASSERT(!TWI_solveBitRate(0, &setting));
+	TEST_ASSERT(!TWI_solveBitRate(F_CPU, &setting));
+	TEST_ASSERT_EQUAL(0, setting.twbr);
+	TEST_ASSERT(!TWI_solveBitRate(10UL, &setting));
+	TEST_ASSERT_EQUAL(255, setting.twbr);
+	TEST_ASSERT_EQUAL(3, setting.twps);
+}
+
+/* TWBR and TWPS seen while the transaction is busy, 0xFFFF if they changed */
+static uint16 busy_bit_rate(TWI_Transaction *transaction) {
+	uint16 seen = 0;
+	uint16 now;
+
+	TEST_ASSERT(TWI_submit(transaction));
+	seen = (uint16) ((TWBR << 8) | (TWSR & 0x03));
+	while (TWI_isBusy()) {
+		now = (uint16) ((TWBR << 8) | (TWSR & 0x03));
+		if (now != seen) {
+			seen = 0xFFFF;
+		}
+		HOST_advanceCycles(16);
+	}
+	return seen;
+}
+
+/* A slow transaction does not slow down the next ones */
+static void test_transaction_bit_rate(void) {
+	TWI_DEFINE_BIT_RATE(slow, 100000UL);
+	uint8 data[2] = { 1, 2 };
+	TWI_Transaction transaction = { .address = DEVICE_ADDRESS, .write_data = data,
+			.write_length = 2, .callback = transaction_done, .bit_rate = &slow };
+
+	setup();
+	GLOBAL_INTERRUPT_ENABLE();
+	TEST_ASSERT_EQUAL((slow.twbr << 8) | slow.twps, busy_bit_rate(&transaction));
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, last_result);
+	/* Back to the TWI_init rate for the blocking functions */
+	TEST_ASSERT_EQUAL(SCL_400kbit, TWBR);
+	TEST_ASSERT_EQUAL(400000UL, TWI_getSclFrequency());
+
+	transaction.bit_rate = NULL_PTR;
+	TEST_ASSERT_EQUAL(SCL_400kbit << 8, busy_bit_rate(&transaction));
+	TEST_ASSERT_EQUAL(TWI_RESULT_OK, last_result);
+
+	/* TWI_setBitRate changes the default */
+	TWI_setBitRate(&slow);
+	TEST_ASSERT_EQUAL((slow.twbr << 8) | slow.twps, busy_bit_rate(&transaction));
+	GLOBAL_INTERRUPT_DISABLE();
+}
+
+int main(void) {
+	printf("test_twi\n");
+	TEST_RUN(test_blocking_timeout_length);
+	TEST_RUN(test_tick_defers_recovery);
+	TEST_RUN(test_solve_bit_rate);
+	TEST_RUN(test_transaction_bit_rate);
+	TEST_RUN(test_submit_while_addressed);
+	TEST_RUN(test_submit_with_slave_twint_pending);
+	TEST_RUN(test_blocking_while_addressed);
+	TEST_RUN(test_master_keeps_slave_ack);
+	return TEST_END();
+}
@@ -11,6 +11,10 @@
 
 #include "delay.h"
 
+#if defined (HOST_BUILD)
+#include "MCAL/Host_Model/host_model.h"
+#endif
+
 /**
  * @brief Creates a delay for a specified number of microseconds.
  *
@@ -33,6 +37,12 @@ void delay_us(uint16 us) {
     if (us == 0)
         return;
 
+#if defined (HOST_BUILD)
+    /**
+     * No busy loop on the host, just advance the simulated time
+     */
+    HOST_advanceCycles((uint32) us * (F_CPU / 1000000UL));
+#else
     /**
      * 16 cycles per microsecond (for 16 MHz clock)
      */
@@ -47,6 +57,7 @@ void delay_us(uint16 us) {
         : "=w" (loops)         /** Output operand */
         : "0" (loops)          /** Input operand */
     );
+#endif
 }
 
 /**
@@ -0,0 +1,272 @@
+/**
+ * @file format.c
+ * @brief Implementation of the printf-style formatter writing to a sink.
+ *
+ * The format string is parsed once, left to right, and every character is passed
+ * to the sink as soon as it is known. Numbers are converted into a digit array of
+ * FORMAT_MAX_DIGITS digits on the stack, the only storage used by the formatter.
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#include "format.h"
+
+#define FORMAT_FLAG_LEFT  0x01 /* '-' */
+#define FORMAT_FLAG_ZERO  0x02 /* '0' */
+#define FORMAT_FLAG_PLUS  0x04 /* '+' */
+#define FORMAT_FLAG_LONG  0x08 /* 'l' */
+#define FORMAT_FLAG_UPPER 0x10 /* 'X' */
+
+/* Decimals of %q when no precision is given */
+#define FORMAT_DEFAULT_DECIMALS 2
+
+/* Largest width or precision, the fields are 8-bit */
+#define FORMAT_MAX_FIELD 0xFF
+
+/*
+ * Decimal digits of the largest uint32 (4294967295), log10(2) ~ 77 / 256: 10,
+ * also in the host build where std_types.h takes the <stdint.h> types.
+ */
+#define FORMAT_MAX_DIGITS (((sizeof(uint32) * 8 * 77) / 256) + 1)
+
+/**
+ * @brief State of one FORMAT_vprint call.
+ */
+typedef struct {
+	FormatSink sink;
+	uint16 count;
+	uint8 flags;
+	uint8 width;
+	uint8 precision;
+} FORMAT_State;
+
+static void FORMAT_put(FORMAT_State *state, uint8 character) {
+	state->sink(character);
+	state->count++;
+}
+
+static void FORMAT_pad(FORMAT_State *state, uint8 character, uint8 length) {
+	while (length > 0) {
+		FORMAT_put(state, character);
+		length--;
+	}
+}
+
+/**
+ * @brief Write a number with its sign, decimal point and padding.
+ *
+ * @param magnitude Absolute value of the number.
+ * @param sign '-', '+' or 0 for no sign.
+ * @param base 10 or 16.
+ * @param decimals Number of digits after the decimal point, 0 for integers.
+ */
+static void FORMAT_number(FORMAT_State *state, uint32 magnitude, uint8 sign,
+		uint8 base, uint8 decimals) {
+	uint8 digits[FORMAT_MAX_DIGITS];
+	uint8 count = 0;
+	uint8 length;
+	uint8 digit;
+	uint16 short_magnitude;
+
+	/* 16-bit divisions are much cheaper on the AVR, use them when possible */
+	while (magnitude > 0xFFFF) {
+		digits[count++] = magnitude % base;
+		magnitude /= base;
+	}
+	short_magnitude = (uint16) magnitude;
+	do {
+		digits[count++] = short_magnitude % base;
+		short_magnitude /= base;
+	} while (short_magnitude != 0);
+
+	/* A fixed point number has at least one digit before the point: 5 -> 0.05 */
+	if (decimals >= FORMAT_MAX_DIGITS) {
+		decimals = FORMAT_MAX_DIGITS - 1;
+	}
+	while (count <= decimals) {
+		digits[count++] = 0;
+	}
+
+	length = count + ((decimals != 0) ? 1 : 0) + ((sign != 0) ? 1 : 0);
+	length = (state->width > length) ? (state->width - length) : 0;
+
+	if (!(state->flags & (FORMAT_FLAG_LEFT | FORMAT_FLAG_ZERO))) {
+		FORMAT_pad(state, ' ', length);
+	}
+	if (sign != 0) {
+		FORMAT_put(state, sign);
+	}
+	if ((state->flags & (FORMAT_FLAG_LEFT | FORMAT_FLAG_ZERO)) == FORMAT_FLAG_ZERO) {
+		FORMAT_pad(state, '0', length);
+	}
+	while (count > 0) {
+		count--;
+		if ((count + 1) == decimals) {
+			FORMAT_put(state, '.');
+		}
+		digit = digits[count];
+		if (digit < 10) {
+			FORMAT_put(state, '0' + digit);
+		} else {
+			FORMAT_put(state,
+					((state->flags & FORMAT_FLAG_UPPER) ? 'A' : 'a') + digit - 10);
+		}
+	}
+	if (state->flags & FORMAT_FLAG_LEFT) {
+		FORMAT_pad(state, ' ', length);
+	}
+}
+
+static void FORMAT_string(FORMAT_State *state, const char *string) {
+	uint8 length = 0;
+
+	if (string == NULL_PTR) {
+		string = "(null)";
+	}
+	while ((string[length] != '\0') && (length < 0xFF)) {
+		length++;
+	}
+	length = (state->width > length) ? (state->width - length) : 0;
+
+	if (!(state->flags & FORMAT_FLAG_LEFT)) {
+		FORMAT_pad(state, ' ', length);
+	}
+	while (*string != '\0') {
+		FORMAT_put(state, *string);
+		string++;
+	}
+	if (state->flags & FORMAT_FLAG_LEFT) {
+		FORMAT_pad(state, ' ', length);
+	}
+}
+
+/**
+ * @brief Read a decimal field (width or precision), or take it from the arguments for '*'.
+ *
+ * As in printf, a negative '*' width sets the '-' flag and uses its magnitude
+ * (flags given), a negative '*' precision is taken as no precision (flags NULL_PTR).
+ */
+static const char* FORMAT_field(const char *format, uint8 *value, uint8 *flags,
+		va_list *args) {
+	int field;
+
+	if (*format == '*') {
+		field = va_arg(*args, int);
+		if (field < 0) {
+			if (flags == NULL_PTR) {
+				*value = FORMAT_DEFAULT_DECIMALS;
+				return format + 1;
+			}
+			*flags |= FORMAT_FLAG_LEFT;
+			field = (field < -FORMAT_MAX_FIELD) ? FORMAT_MAX_FIELD : -field;
+		}
+		*value = (field > FORMAT_MAX_FIELD) ? FORMAT_MAX_FIELD : (uint8) field;
+		return format + 1;
+	}
+	*value = 0;
+	while ((*format >= '0') && (*format <= '9')) {
+		*value = (*value * 10) + (*format - '0');
+		format++;
+	}
+	return format;
+}
+
+uint16 FORMAT_vprint(FormatSink sink, const char *format, va_list args) {
+	FORMAT_State state;
+	va_list arguments;
+	sint32 value;
+	uint32 magnitude;
+	uint8 sign;
+
+	state.sink = sink;
+	state.count = 0;
+	va_copy(arguments, args);
+
+	while (*format != '\0') {
+		if (*format != '%') {
+			FORMAT_put(&state, *format);
+			format++;
+			continue;
+		}
+		format++;
+
+		/* Flags */
+		state.flags = 0;
+		for (;; format++) {
+			if (*format == '-') {
+				state.flags |= FORMAT_FLAG_LEFT;
+			} else if (*format == '0') {
+				state.flags |= FORMAT_FLAG_ZERO;
+			} else if (*format == '+') {
+				state.flags |= FORMAT_FLAG_PLUS;
+			} else {
+				break;
+			}
+		}
+
+		/* Width, precision and length */
+		format = FORMAT_field(format, &state.width, &state.flags, &arguments);
+		state.precision = FORMAT_DEFAULT_DECIMALS;
+		if (*format == '.') {
+			format = FORMAT_field(format + 1, &state.precision, NULL_PTR,
+					&arguments);
+		}
+		if (*format == 'l') {
+			state.flags |= FORMAT_FLAG_LONG;
+			format++;
+		}
+
+		switch (*format) {
+		case 'd':
+		case 'q':
+			value = (state.flags & FORMAT_FLAG_LONG) ?
+					va_arg(arguments, long) : va_arg(arguments, int);
+			/* Negate as unsigned so the most negative value has a magnitude too */
+			magnitude = (value < 0) ? (0UL - (uint32) value) : (uint32) value;
+			sign = (value < 0) ? '-' :
+					((state.flags & FORMAT_FLAG_PLUS) ? '+' : 0);
+			FORMAT_number(&state, magnitude, sign, 10,
+					(*format == 'q') ? state.precision : 0);
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+			magnitude = (state.flags & FORMAT_FLAG_LONG) ?
+					va_arg(arguments, unsigned long) :
+					va_arg(arguments, unsigned int);
+			if (*format == 'X') {
+				state.flags |= FORMAT_FLAG_UPPER;
+			}
+			FORMAT_number(&state, magnitude, 0, (*format == 'u') ? 10 : 16, 0);
+			break;
+		case 's':
+			FORMAT_string(&state, va_arg(arguments, const char*));
+			break;
+		case 'c':
+			FORMAT_put(&state, (uint8) va_arg(arguments, int));
+			break;
+		case '%':
+			FORMAT_put(&state, '%');
+			break;
+		default:
+			/* Unknown conversion or end of string, stop here */
+			va_end(arguments);
+			return state.count;
+		}
+		format++;
+	}
+
+	va_end(arguments);
+	return state.count;
+}
+
+uint16 FORMAT_print(FormatSink sink, const char *format, ...) {
+	va_list args;
+	uint16 count;
+
+	va_start(args, format);
+	count = FORMAT_vprint(sink, format, args);
+	va_end(args);
+	return count;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file format.h
+ * @brief Small printf-style formatter writing each character to a sink.
+ *
+ * This header file declares a formatter with no buffer and no libc formatting:
+ * every character goes straight to a sink function, so the output can be sent
+ * to UART_sendByte, queued in the UART TX ring (UART_sendByte in interrupt mode)
+ * or drawn with LCD_displayCharacter:
+ *
+ *     FORMAT_print(UART_sendByte, "T=%3.1q C, n=%u\r\n", temperature_x10, count);
+ *     FORMAT_print(LCD_displayCharacter, "%04x", value);
+ *
+ * Conversions: %[flags][width][.precision][l]type
+ *  - flags     : '-' left align, '0' pad numbers with zeros, '+' sign for positives
+ *  - width     : minimum field width, or '*' to take it from the arguments (int),
+ *                a negative one left aligns like the '-' flag
+ *  - precision : number of decimals of %q (default 2), or '*' from the arguments,
+ *                a negative one is the default
+ *  - l         : the argument is long (32 bits) instead of int (16 bits on AVR)
+ *  - type      : d signed decimal, u unsigned decimal, x / X hexadecimal,
+ *                q signed fixed point (the integer 1234 with %.2q prints 12.34),
+ *                s string, c character, %% a '%'
+ *
+ * The numbers are converted with 16-bit divisions when the value fits in 16 bits,
+ * and the digits are emitted directly, compared to ltoa + string output there is
+ * no intermediate buffer to size and no 32-bit division for int arguments.
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#ifndef ATMEGA32_DRIVERS_FORMAT_H_
+#define ATMEGA32_DRIVERS_FORMAT_H_
+
+#include <stdarg.h>
+#include "std_types.h"
+
+/**
+ * @brief Output of the formatter, called once per character.
+ */
+typedef void (*FormatSink)(uint8 character);
+
+/**
+ * @brief Format the arguments and write the result to the sink.
+ *
+ * @param sink Character output, for example UART_sendByte or LCD_displayCharacter.
+ * @param format printf-style format, see the conversions above.
+ * @return The number of characters written.
+ */
+uint16 FORMAT_print(FormatSink sink, const char *format, ...);
+
+/**
+ * @brief FORMAT_print with a va_list, for wrappers with their own variable arguments.
+ */
+uint16 FORMAT_vprint(FormatSink sink, const char *format, va_list args);
+
+#endif /* ATMEGA32_DRIVERS_FORMAT_H_ */
@@ -0,0 +1,195 @@
+/**
+ * @file profiler.c
+ * @brief Implementation of the cycle, memory and stack measurement helpers.
+ *
+ * Timer1 runs free in normal mode, a measurement is the difference of two TCNT1
+ * reads minus the cost of an empty PROFILER_start / PROFILER_stop pair measured
+ * once in PROFILER_init. The memory sizes come from the symbols of the avr-libc
+ * linker script.
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#include "profiler.h"
+#include "MCAL/Atmega32_Registers.h"
+
+#if (PROFILER_PRESCALER == 1)
+#define PROFILER_CLOCK_SELECT 1 /* CS12:0 = 001, F_CPU */
+#elif (PROFILER_PRESCALER == 8)
+#define PROFILER_CLOCK_SELECT 2 /* CS12:0 = 010, F_CPU / 8 */
+#else
+#error "PROFILER_PRESCALER must be 1 or 8"
+#endif
+
+/* CS12:0 of TCCR1B and TICIE1 | OCIE1A | OCIE1B | TOIE1 of TIMSK */
+#define PROFILER_CLOCK_MASK 0x07
+#define PROFILER_TIMSK_MASK 0x3C
+
+/*
+ * Columns of the report. The host model time is not CPU cycles (register
+ * accesses and peripheral waits, see host_model.h), so it is not named so.
+ */
+#if defined (HOST_BUILD)
+#define PROFILER_HEADER "name,calls,min_model_ticks,max_model_ticks,avg_model_ticks\n"
+#else
+#define PROFILER_HEADER "name,calls,min_cycles,max_cycles,avg_cycles\n"
+#endif
+
+/* Longest report line, the entry names are cut to fit */
+#define PROFILER_LINE_SIZE 64
+
+#if !defined (HOST_BUILD)
+/* Symbols defined by the avr-libc linker script */
+extern uint8 _etext;
+extern uint8 __data_start, __data_end;
+extern uint8 __bss_start, __bss_end;
+extern uint8 __heap_start;
+#endif
+
+static uint16 PROFILER_overhead = 0;
+
+/**
+ * @brief Fills the RAM between the end of .bss and the stack pointer.
+ */
+static void PROFILER_paintStack(void) {
+#if !defined (HOST_BUILD)
+	uint8 sreg = SREG;
+	uint8 *address = &__heap_start;
+
+	/* An ISR pushing below SP while painting would be overwritten */
+	GLOBAL_INTERRUPT_DISABLE();
+	while (address < (uint8*) SP) {
+		*address = PROFILER_STACK_PAINT;
+		address++;
+	}
+	SREG = sreg;
+#endif
+}
+
+boolean PROFILER_init(void) {
+	PROFILER_Entry calibration = PROFILER_ENTRY("");
+	uint16 start;
+
+	/* Timer1 is owned by the timer_1 driver or the auto-baud detection */
+	if (((TCCR1B & PROFILER_CLOCK_MASK) != 0) || ((TIMSK & PROFILER_TIMSK_MASK) != 0)) {
+		return FALSE;
+	}
+
+	/* Normal mode, OC1A/OC1B disconnected, free running from 0 to 0xFFFF */
+	TCCR1A = 0;
+	TCCR1B = PROFILER_CLOCK_SELECT;
+
+	PROFILER_overhead = 0;
+	start = PROFILER_start();
+	PROFILER_stop(&calibration, start);
+	PROFILER_overhead = calibration.min_cycles;
+
+	PROFILER_paintStack();
+	return TRUE;
+}
+
+void PROFILER_release(void) {
+	TCCR1B = 0;
+	TCNT1 = 0;
+}
+
+uint16 PROFILER_start(void) {
+	return TCNT1;
+}
+
+void PROFILER_stop(PROFILER_Entry *entry, uint16 start_ticks) {
+	uint16 ticks = TCNT1 - start_ticks;
+	uint32 cycles = (uint32) ticks * PROFILER_PRESCALER;
+
+	cycles = (cycles > PROFILER_overhead) ? (cycles - PROFILER_overhead) : 0;
+
+	entry->calls++;
+	entry->total_cycles += cycles;
+	if (cycles < entry->min_cycles) {
+		entry->min_cycles = cycles;
+	}
+	if (cycles > entry->max_cycles) {
+		entry->max_cycles = cycles;
+	}
+}
+
+uint16 PROFILER_getStackHighWater(void) {
+#if !defined (HOST_BUILD)
+	const uint8 *address = &__heap_start;
+
+	/* The first byte not painted any more is the deepest the stack went */
+	while (address <= (const uint8*) RAMEND && *address == PROFILER_STACK_PAINT) {
+		address++;
+	}
+	return (uint16) (RAMEND - (uint16) address + 1);
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Appends ',' and the decimal value of number to line.
+ */
+static uint8 PROFILER_appendNumber(uint8 *line, uint8 length, uint32 number) {
+	uint8 digits[10];
+	uint8 count = 0;
+
+	do {
+		digits[count++] = '0' + (number % 10);
+		number /= 10;
+	} while (number != 0);
+
+	line[length++] = ',';
+	while (count > 0) {
+		line[length++] = digits[--count];
+	}
+	return length;
+}
+
+static void PROFILER_endLine(uint8 *line, uint8 length, ProfilerSink sink) {
+	line[length++] = '\n';
+	line[length] = '\0';
+	sink(line);
+}
+
+void PROFILER_report(const PROFILER_Entry *entries, uint8 count,
+		ProfilerSink sink) {
+	uint8 line[PROFILER_LINE_SIZE];
+	uint8 length;
+	uint8 i, j;
+
+	sink((const uint8*) PROFILER_HEADER);
+	for (i = 0; i < count; i++) {
+		length = 0;
+		/* Keep room for the 5 + 3 x 10 digits, the separators, '\n' and '\0' */
+		for (j = 0; entries[i].name[j] != '\0'
+				&& length < (PROFILER_LINE_SIZE - 41); j++) {
+			line[length++] = entries[i].name[j];
+		}
+		length = PROFILER_appendNumber(line, length, entries[i].calls);
+		length = PROFILER_appendNumber(line, length,
+				(entries[i].calls != 0) ? entries[i].min_cycles : 0);
+		length = PROFILER_appendNumber(line, length, entries[i].max_cycles);
+		length = PROFILER_appendNumber(line, length,
+				(entries[i].calls != 0) ?
+						(entries[i].total_cycles / entries[i].calls) : 0);
+		PROFILER_endLine(line, length, sink);
+	}
+
+	sink((const uint8*) "text,data,bss,stack\n");
+#if !defined (HOST_BUILD)
+	length = PROFILER_appendNumber(line, 0, (uint16) &_etext);
+	length = PROFILER_appendNumber(line, length,
+			(uint16) (&__data_end - &__data_start));
+	length = PROFILER_appendNumber(line, length,
+			(uint16) (&__bss_end - &__bss_start));
+#else
+	length = PROFILER_appendNumber(line, 0, 0);
+	length = PROFILER_appendNumber(line, length, 0);
+	length = PROFILER_appendNumber(line, length, 0);
+#endif
+	length = PROFILER_appendNumber(line, length, PROFILER_getStackHighWater());
+	/* No name column in this table, drop the leading ',' */
+	PROFILER_endLine(line + 1, length - 1, sink);
+}
@@ -0,0 +1,130 @@
+/**
+ * @file profiler.h
+ * @brief Cycle, memory and stack measurement helpers for the drivers.
+ *
+ * This header file declares a small profiler that runs on the target (or under
+ * simavr) to measure the drivers instead of guessing:
+ *  - cycles per call of any code section, timed with Timer1 (min / max / average),
+ *  - .text / .data / .bss sizes of the linked image,
+ *  - stack high-water mark, found by painting the free RAM at init.
+ *
+ * The report is a CSV table written through a sink such as UART_sendString, so
+ * the output of two builds can be diffed directly:
+ *
+ *     static PROFILER_Entry entries[] = {
+ *         PROFILER_ENTRY("GPIO_writePin"),
+ *         PROFILER_ENTRY("UART_sendByte"),
+ *     };
+ *     uint16 start;
+ *
+ *     if (!PROFILER_init()) {
+ *         ... Timer1 is used by timer_1 / autobaud ...
+ *     }
+ *     for (i = 0; i < 100; i++) {
+ *         start = PROFILER_start();
+ *         GPIO_writePin(A0, LOGIC_HIGH);
+ *         PROFILER_stop(&entries[0], start);
+ *     }
+ *     ...
+ *     PROFILER_report(entries, 2, UART_sendString);
+ *
+ * Worst-case ISR latency of an interrupt = the longest section run with the
+ * interrupts disabled + the longest other ISR + 4 cycles of vector entry, so
+ * time the critical sections and the ISR bodies as entries and add their max.
+ *
+ * Benchmarks/benchmark.c is the ready-made suite built on it (make benchmark on
+ * the host model, make benchmark-avr for the target). Under HOST_BUILD Timer1
+ * counts the model time (register accesses and peripheral waits, not CPU
+ * cycles, see host_model.h) and the report names its columns model_ticks.
+ *
+ * Timer1 ownership: the profiler, the timer_1 driver and the auto-baud detection
+ * (HAL/Auto_Baud) all use Timer1 and can not run together. PROFILER_init refuses
+ * to start (returns FALSE) while Timer1 is clocked or one of its interrupts is
+ * enabled, and PROFILER_release stops Timer1 to hand it back. One measurement must
+ * be shorter than 65535 Timer1 ticks (8.19 ms at 8 MHz with PROFILER_PRESCALER 1).
+ *
+ * @date 2024-07-25
+ * @author Mohamed Sayed
+ */
+
+#ifndef ATMEGA32_DRIVERS_PROFILER_H_
+#define ATMEGA32_DRIVERS_PROFILER_H_
+
+#include "std_types.h"
+
+/**
+ * @brief Timer1 prescaler used for the measurements, 1 (cycle exact) or 8.
+ */
+#define PROFILER_PRESCALER 1
+
+/**
+ * @brief Value written in the free RAM to find the stack high-water mark.
+ */
+#define PROFILER_STACK_PAINT 0xC5
+
+/**
+ * @brief Static initializer of a profiler entry.
+ */
+#define PROFILER_ENTRY(NAME) { (NAME), 0, 0xFFFFFFFFUL, 0, 0 }
+
+/**
+ * @brief Accumulated measurements of one code section.
+ */
+typedef struct {
+	const char *name; /**< name printed in the report */
+	uint16 calls; /**< number of measurements */
+	uint32 min_cycles; /**< shortest measurement */
+	uint32 max_cycles; /**< longest measurement */
+	uint32 total_cycles; /**< sum of the measurements, for the average */
+} PROFILER_Entry;
+
+/**
+ * @brief Output of the report, called once per line.
+ */
+typedef void (*ProfilerSink)(const uint8 *str);
+
+/**
+ * @brief Starts Timer1 as a free running counter, calibrates the measurement
+ * overhead and paints the free RAM for the stack high-water mark.
+ *
+ * @return FALSE without touching Timer1 when it is already in use (clock
+ * selected or a Timer1 interrupt enabled), TRUE otherwise.
+ */
+boolean PROFILER_init(void);
+
+/**
+ * @brief Stops Timer1 so the timer_1 driver or the auto-baud detection can use it.
+ */
+void PROFILER_release(void);
+
+/**
+ * @brief Starts a measurement.
+ *
+ * @return The Timer1 count to pass to PROFILER_stop.
+ */
+uint16 PROFILER_start(void);
+
+/**
+ * @brief Ends a measurement and adds it to the entry.
+ *
+ * @param entry The entry of the measured code section.
+ * @param start_ticks The value returned by PROFILER_start.
+ */
+void PROFILER_stop(PROFILER_Entry *entry, uint16 start_ticks);
+
+/**
+ * @brief Returns the deepest stack usage in bytes since PROFILER_init.
+ */
+uint16 PROFILER_getStackHighWater(void);
+
+/**
+ * @brief Writes the entries and the memory usage as CSV lines.
+ *
+ * @param entries The measured entries.
+ * @param count Number of entries.
+ * @param sink Output of the lines.
+ */
+void PROFILER_report(const PROFILER_Entry *entries, uint8 count,
+		ProfilerSink sink);
+
+#endif /* ATMEGA32_DRIVERS_PROFILER_H_ */
@@ -48,7 +48,22 @@ typedef unsigned char boolean;
 /**
  * @brief Standard Type Definitions
  * @details These typedefs define commonly used data types in AVR programming.
+ * The host build (HOST_BUILD, see MCAL/Host_Model/host_model.h) takes the
+ * fixed-width types of <stdint.h> instead, because long is 64-bit on an x86-64
+ * Linux host and the drivers must see the integer widths of the target there.
  */
+#if defined (HOST_BUILD)
+#include <stdint.h>
+
+typedef uint8_t uint8; /**< Unsigned 8-bit integer: 0 to 255 */
+typedef int8_t sint8; /**< Signed 8-bit integer: -128 to +127 */
+typedef uint16_t uint16; /**< Unsigned 16-bit integer: 0 to 65535 */
+typedef int16_t sint16; /**< Signed 16-bit integer: -32768 to +32767 */
+typedef uint32_t uint32; /**< Unsigned 32-bit integer: 0 to 4294967295 */
+typedef int32_t sint32; /**< Signed 32-bit integer: -2147483648 to +2147483647 */
+typedef uint64_t uint64; /**< Unsigned 64-bit integer: 0 to 18446744073709551615 */
+typedef int64_t sint64; /**< Signed 64-bit integer: -9223372036854775808 to +9223372036854775807 */
+#else
 typedef unsigned char uint8; /**< Unsigned 8-bit integer: 0 to 255 */
 typedef signed char sint8; /**< Signed 8-bit integer: -128 to +127 */
 typedef unsigned short uint16; /**< Unsigned 16-bit integer: 0 to 65535 */
@@ -57,6 +72,7 @@ typedef unsigned long uint32; /**< Unsigned 32-bit integer: 0 to 4294967295 */
 typedef signed long sint32; /**< Signed 32-bit integer: -2147483648 to +2147483647 */
 typedef unsigned long long uint64; /**< Unsigned 64-bit integer: 0 to 18446744073709551615 */
 typedef signed long long sint64; /**< Signed 64-bit integer: -9223372036854775808 to +9223372036854775807 */
+#endif
 typedef float float32; /**< Single-precision floating point */
 typedef double float64; /**< Double-precision floating point */
 